@@ -0,0 +1,171 @@
+#!/bin/bash
+# Scaling benchmark of the backends: every backend x threads x input is run REPEAT times after WARMUP discarded runs.
+# The report has the median time of every configuration, the speedup and the parallel efficiency against the
+# sequential baseline. The runs are read from the --output csv records, so the text output of the programs is ignored.
+# Every backend runs the generic search by edges with the weight and edge count bounds, without the tree decomposition
+# DP, the Gray code and packed engines, the enumeration of the leaves and the split into blocks. The forced moves of
+# the sequential and portfolio backends cannot be turned off, so their trees are smaller than the trees of the others.
+# The report starts with the search of every backend, the speedup and efficiency columns compare those searches.
+# The portfolio races differently ordered copies of the search, its threads are the copies.
+#
+# Settings (environment variables):
+#   BIN_DIR     directory with the executables sequential, parallel_task, parallel_data, mpi and portfolio (default: _build)
+#   BACKENDS    backends to run, the sequential one is always run as the baseline (default: all five)
+#   THREADS     thread counts of the parallel backends (default: 1 2 4)
+#   RANKS       number of processes of mpi, one of them is the master (default: 3)
+#   PIN         OpenMP thread binding of parallel_task, parallel_data and the mpi ranks, none or an OMP_PROC_BIND
+#               policy such as close or spread. The mpi ranks are then bound to THREADS cores each. (default: none)
+#   LEVELS      input folders in inputs/ (default: easy medium)
+#   REPEAT      measured runs of every configuration (default: 5)
+#   WARMUP      discarded runs of every configuration (default: 1)
+#   ARGS        extra arguments of every run (default: none)
+#   RESULTS_DIR directory of the runs and of the report (default: bench/results)
+# Usage: ./bench/bench.sh, run from the root of the repository
+
+BIN_DIR=${BIN_DIR:-_build}
+BACKENDS=${BACKENDS:-"sequential parallel_task parallel_data mpi portfolio"}
+THREADS=${THREADS:-"1 2 4"}
+RANKS=${RANKS:-3}
+PIN=${PIN:-none}
+LEVELS=${LEVELS:-"easy medium"}
+REPEAT=${REPEAT:-5}
+WARMUP=${WARMUP:-1}
+ARGS=${ARGS:-""}
+RESULTS_DIR=${RESULTS_DIR:-bench/results}
+RUNS_FILE=${RESULTS_DIR}/bench_runs.csv
+REPORT_FILE=${RESULTS_DIR}/bench_report.txt
+
+# The same thread count and binding for every OpenMP backend, mpirun passes them on to its ranks. Without MPI_BIND
+# every rank is bound to THREADS cores, on fewer cores the ranks share them.
+if [ "${PIN}" = none ]
+then
+  export OMP_PROC_BIND=false
+  MPI_BIND="--bind-to none"
+else
+  export OMP_PROC_BIND=${PIN} OMP_PLACES=cores
+fi
+
+# Runs one configuration once, prints the csv record without its header
+run() {
+  backend=$1
+  threads=$2
+  input=$3
+  case ${backend} in
+    sequential) "${BIN_DIR}/sequential" --output csv --dp-width 0 --engine edge --leaf-vertices 0 --no-preprocess ${ARGS} --file "${input}" ;;
+    parallel_task) OMP_NUM_THREADS=${threads} "${BIN_DIR}/parallel_task" -t "${threads}" --output csv --dp-width 0 --no-preprocess ${ARGS} --file "${input}" ;;
+    parallel_data) OMP_NUM_THREADS=${threads} "${BIN_DIR}/parallel_data" -t "${threads}" --output csv --dp-width 0 --engine edge --no-preprocess ${ARGS} --file "${input}" ;;
+    mpi) mpirun --oversubscribe ${MPI_BIND:---map-by slot:PE=${threads} --bind-to core:overload-allowed} -np "${RANKS}" \
+           -x OMP_NUM_THREADS="${threads}" -x OMP_PROC_BIND ${OMP_PLACES:+-x OMP_PLACES} \
+           "${BIN_DIR}/mpi" -t "${threads}" --output csv ${ARGS} --file "${input}" ;;
+    portfolio) "${BIN_DIR}/portfolio" -t "${threads}" --output csv --leaf-vertices 0 ${ARGS} --file "${input}" ;;
+  esac 2>/dev/null | tail -n +2
+}
+
+# The search every backend runs, the first lines of the report
+describe() {
+  echo "Searches, the speedup and efficiency compare them against the sequential one, binding ${PIN}:"
+  for backend in sequential $(echo "${BACKENDS}" | tr ' ' '\n' | grep -vx sequential)
+  do
+    case ${backend} in
+      sequential) echo "  sequential     search by edges with forced moves, 1 thread" ;;
+      parallel_task) echo "  parallel_task  search by edges, OpenMP tasks" ;;
+      parallel_data) echo "  parallel_data  search by edges, OpenMP loop over a frontier of states" ;;
+      mpi) echo "  mpi            search by edges, ${RANKS} ranks with a master, OpenMP threads in the workers" ;;
+      portfolio) echo "  portfolio      search by edges with forced moves, one differently ordered copy per thread, not bound" ;;
+    esac
+  done
+}
+
+for backend in sequential ${BACKENDS}
+do
+  if [ ! -x "${BIN_DIR}/${backend}" ]
+  then
+    echo "Missing ${BIN_DIR}/${backend}, build it first or set BIN_DIR"
+    exit 1
+  fi
+done
+
+mkdir -p "${RESULTS_DIR}"
+echo "backend,input,vertices,edges,cost,red,blue,elapsed_us,nodes,threads,ranks" > "${RUNS_FILE}"
+for level in ${LEVELS}
+do
+  for input in inputs/"${level}"/*.txt
+  do
+    # The baseline first, then the others without repeating it
+    for backend in sequential $(echo "${BACKENDS}" | tr ' ' '\n' | grep -vx sequential)
+    do
+      if [ "${backend}" = sequential ]
+      then
+        thread_counts=1
+      else
+        thread_counts=${THREADS}
+      fi
+      for threads in ${thread_counts}
+      do
+        echo "${input} ${backend} threads=${threads}"
+        for _ in $(seq "${WARMUP}")
+        do
+          run "${backend}" "${threads}" "${input}" > /dev/null
+        done
+        for _ in $(seq "${REPEAT}")
+        do
+          record=$(run "${backend}" "${threads}" "${input}")
+          if [ -z "${record}" ]
+          then
+            echo "No result of ${backend} on ${input}, run it by hand to see the error"
+            exit 1
+          fi
+          echo "${record}" >> "${RUNS_FILE}"
+        done
+      done
+    done
+  done
+done
+
+# Median of every configuration, speedup = baseline median / median, efficiency = speedup / (threads x ranks).
+# The worker ranks of mpi do the search, so its efficiency is counted against (ranks - 1) x threads.
+{
+describe
+awk -F, '
+NR == 1 { next }
+{
+  input = $2; gsub(/"/, "", input)
+  key = input SUBSEP $1 SUBSEP $10 SUBSEP $11
+  if (!(key in count)) order[++configurations] = key
+  times[key, ++count[key]] = $8
+  if (input in cost && cost[input] != $5) mismatch[input] = 1
+  cost[input] = $5
+}
+function median(key,    i, j, n, value, sorted) {
+  n = count[key]
+  for (i = 1; i <= n; i++) {
+    value = times[key, i]
+    for (j = i - 1; j >= 1 && sorted[j] > value; j--) sorted[j + 1] = sorted[j]
+    sorted[j + 1] = value
+  }
+  return n % 2 ? sorted[(n + 1) / 2] : (sorted[n / 2] + sorted[n / 2 + 1]) / 2
+}
+END {
+  for (i = 1; i <= configurations; i++) {
+    split(order[i], field, SUBSEP)
+    medians[order[i]] = median(order[i])
+    if (field[2] == "sequential") baseline[field[1]] = medians[order[i]]
+  }
+  printf "%-32s %-14s %5s %7s %5s %12s %8s %10s\n", "input", "backend", "ranks", "threads", "runs", "median [ms]", "speedup", "efficiency"
+  for (i = 1; i <= configurations; i++) {
+    split(order[i], field, SUBSEP)
+    workers = field[3] * (field[2] == "mpi" && field[4] > 1 ? field[4] - 1 : field[4])
+    speedup = medians[order[i]] > 0 ? baseline[field[1]] / medians[order[i]] : 0
+    printf "%-32s %-14s %5d %7d %5d %12.3f %8.2f %10.2f\n", field[1], field[2], field[4], field[3], count[order[i]],
+           medians[order[i]] / 1000, speedup, speedup / workers
+  }
+  status = 0
+  for (input in mismatch) {
+    print "Different costs of " input
+    status = 1
+  }
+  exit status
+}
+' "${RUNS_FILE}"
+} | tee "${REPORT_FILE}"
+exit "${PIPESTATUS[0]}"
@@ -0,0 +1,136 @@
+/*
+ * Jorge Zuniga (zuniga.cz)
+ * FIT CVUT NI-PDP
+ * 2023
+ */
+#include <iostream>
+#include <utility>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <cstdint>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+#define MAX_VERTICES 150
+#define MAX_WEIGHT 120
+#define MIN_WEIGHT 80
+#define BINARY_MAGIC "PDPG"
+
+/*
+ * Binary instance format, little endian on every host, no padding:
+ *   char     magic[4]                     "PDPG"
+ *   uint8_t  num_of_vertices              at most 150, larger inputs are rejected
+ *   uint16_t edges_size
+ *   uint32_t edges_total_weight
+ *   Edge     edges[edges_size]            u, v, weight as bytes, sorted the same way as ProblemInstance sorts them
+ * The edges can be copied straight into ProblemInstance, nothing has to be parsed or sorted.
+ */
+
+class Edge {
+public:
+    uint8_t u; // < 150
+    uint8_t v; // < 150
+    uint8_t weight; // 80 <= weight <= 120
+public:
+    Edge(int u, int v, int weight) {
+        this->u = u;
+        this->v = v;
+        this->weight = weight;
+    }
+
+    bool operator > (const Edge & other) const {
+        if (this->weight != other.weight)
+            return this->weight > other.weight;
+        else if (this->u != other.u)
+            return this->u > other.u;
+        else if (this->v != other.v)
+            return this->v > other.v;
+        return false;
+    }
+};
+
+// Written byte by byte from the lowest one, so the files are the same on every host
+template <typename T>
+void writeValue(ofstream & output_file, T value) {
+    for (size_t i = 0; i < sizeof(value); i++)
+        output_file.put(char(uint8_t(uint64_t(value) >> (8 * i))));
+}
+
+bool convertFile(const fs::path & input_file_path, const fs::path & output_file_path) {
+    ifstream input_file(input_file_path);
+    if (!input_file.is_open()) {
+        cout << "Error opening " << input_file_path.string() << endl;
+        return false;
+    }
+    int num_of_vertices = 0;
+    input_file >> num_of_vertices;
+    if (num_of_vertices <= 0) {
+        cout << "Wrong number of vertices in " << input_file_path.string() << endl;
+        return false;
+    }
+    // The vertices are stored as bytes
+    if (num_of_vertices > MAX_VERTICES) {
+        cout << "Too many vertices in " << input_file_path.string() << ", the binary format holds at most " << MAX_VERTICES << endl;
+        return false;
+    }
+    vector<Edge> edges;
+    for (int row = 0; row < num_of_vertices; row++) {
+        for (int column = 0; column < num_of_vertices; column++) {
+            int weight;
+            input_file >> weight;
+            if (column > row and MIN_WEIGHT <= weight and weight <= MAX_WEIGHT)
+                edges.emplace_back(row, column, weight);
+        }
+    }
+    sort(edges.begin(), edges.end(), greater<>());
+    uint32_t edges_total_weight = 0;
+    for (auto & edge : edges)
+        edges_total_weight += edge.weight;
+    fs::create_directories(output_file_path.parent_path());
+    ofstream output_file(output_file_path, ios::binary);
+    if (!output_file.is_open()) {
+        cout << "Error opening " << output_file_path.string() << endl;
+        return false;
+    }
+    output_file.write(BINARY_MAGIC, 4);
+    writeValue(output_file, uint8_t(num_of_vertices));
+    writeValue(output_file, uint16_t(edges.size()));
+    writeValue(output_file, edges_total_weight);
+    for (auto & edge : edges) {
+        writeValue(output_file, edge.u);
+        writeValue(output_file, edge.v);
+        writeValue(output_file, edge.weight);
+    }
+    cout << "Converted " << input_file_path.string() << " -> " << output_file_path.string() << endl;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        cout << "Převede textové vstupy do binárního formátu." << endl;
+        cout << "Použití: converter <soubor nebo složka> <výstupní složka>" << endl;
+        return 1;
+    }
+    fs::path input_path = argv[1];
+    fs::path output_path = argv[2];
+    vector<fs::path> paths_to_files;
+    if (fs::is_directory(input_path)) {
+        for (const auto & entry : fs::directory_iterator(input_path))
+            if (entry.is_regular_file())
+                paths_to_files.push_back(entry.path());
+        sort(paths_to_files.begin(), paths_to_files.end());
+    } else {
+        paths_to_files.push_back(input_path);
+    }
+    bool all_converted = true;
+    for (const auto & file_path : paths_to_files) {
+        fs::path output_file_path = output_path / file_path.filename();
+        output_file_path.replace_extension(".bin");
+        all_converted &= convertFile(file_path, output_file_path);
+    }
+    return all_converted ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+/*
+ * Jorge Zuniga (zuniga.cz)
+ * FIT CVUT NI-PDP
+ * 2023
+ */
+// Microbenchmarks of the hot parts of the sequential search, measured on fixed states of the inputs
+#define SEQUENTIAL_NO_MAIN
+#include "../sequential/sequential.cpp"
+
+#include <benchmark/benchmark.h>
+
+#ifndef INPUTS_DIR
+#define INPUTS_DIR "inputs"
+#endif
+
+// Easy enough for the whole search to be measured
+#define MICROBENCH_INPUT INPUTS_DIR "/easy/graf_15_8.txt"
+
+struct ProblemInstanceAccess {
+    template <typename V>
+    static SolutionState<V> & initialState(ProblemInstance<V> & instance) {
+        instance.initial_state.edges = instance.edges;
+        return instance.initial_state;
+    }
+
+    template <typename V>
+    static SolutionState<V> & bestState(ProblemInstance<V> & instance) {
+        return instance.best_state;
+    }
+
+    template <typename V>
+    static bool noBetterSolutionPossible(ProblemInstance<V> & instance, const SolutionState<V> & state) {
+        return instance.noBetterSolutionPossible(state);
+    }
+
+    template <typename V>
+    static void findBestStateDFS(ProblemInstance<V> & instance, const SolutionState<V> & state) {
+        instance.countOpenDegrees(state);
+        instance.findBestStateDFS(state);
+    }
+};
+
+template <typename V>
+unique_ptr<ProblemInstance<V>> loadInstance(const string & input_file_path) {
+    int num_of_vertices = 0;
+    vector<InputEdge> edges;
+    if (!InputHandler::parseFile(input_file_path, num_of_vertices, edges) or num_of_vertices <= 0 or
+        num_of_vertices > V::max_vertices) {
+        cout << "Error opening " << input_file_path << endl;
+        exit(1);
+    }
+    return make_unique<ProblemInstance<V>>(input_file_path, num_of_vertices, edges);
+}
+
+// State after the first depth edges of the first branch of the search, about half of it is colored at half the edges
+template <typename V>
+SolutionState<V> stateAtDepth(ProblemInstance<V> & instance, int depth) {
+    SolutionState<V> state = ProblemInstanceAccess::initialState(instance);
+    state.resetSolution();
+    while (state.edge_index < depth and !state.isLeaf()) {
+        int u = state.edges[state.edge_index].u;
+        int v = state.edges[state.edge_index].v;
+        if (state.colors[u] == NO_COLOR and state.colors[v] == NO_COLOR) {
+            state.colors[u] = RED;
+            state.colors[v] = BLUE;
+        } else if (state.colors[v] == NO_COLOR) {
+            state.colors[v] = SolutionState<V>::getOppositeColor(state.colors[u]);
+        } else if (state.colors[u] == NO_COLOR) {
+            state.colors[u] = SolutionState<V>::getOppositeColor(state.colors[v]);
+        }
+        if (state.colors[u] != state.colors[v])
+            state.addEdge();
+        else
+            state.skipEdge();
+    }
+    return state;
+}
+
+template <typename V>
+void BM_SolutionStateCopy(benchmark::State & bench_state) {
+    auto instance = loadInstance<V>(MICROBENCH_INPUT);
+    SolutionState<V> state = stateAtDepth(*instance, int(bench_state.range(0)));
+    for (auto _ : bench_state) {
+        SolutionState<V> copy = state;
+        benchmark::DoNotOptimize(copy);
+        benchmark::ClobberMemory();
+    }
+    bench_state.SetBytesProcessed(int64_t(bench_state.iterations()) * int64_t(sizeof(SolutionState<V>)));
+}
+// The vertex count classes differ only in the size of the color array
+BENCHMARK_TEMPLATE(BM_SolutionStateCopy, Vertices64)->Arg(30);
+BENCHMARK_TEMPLATE(BM_SolutionStateCopy, Vertices150)->Arg(30);
+BENCHMARK_TEMPLATE(BM_SolutionStateCopy, Vertices1024)->Arg(30);
+
+void BM_IsConnected(benchmark::State & bench_state) {
+    auto instance = loadInstance<Vertices64>(MICROBENCH_INPUT);
+    SolutionState<Vertices64> state = stateAtDepth(*instance, int(bench_state.range(0)));
+    for (auto _ : bench_state)
+        benchmark::DoNotOptimize(state.isConnected());
+}
+BENCHMARK(BM_IsConnected)->Arg(0)->Arg(30);
+
+// The check colors the state, so every iteration starts from an uncolored copy, see BM_SolutionStateCopy for its cost
+void BM_IsBipartite(benchmark::State & bench_state) {
+    auto instance = loadInstance<Vertices64>(MICROBENCH_INPUT);
+    SolutionState<Vertices64> state = stateAtDepth(*instance, 0);
+    for (auto _ : bench_state) {
+        SolutionState<Vertices64> copy = state;
+        benchmark::DoNotOptimize(copy.isBipartite());
+    }
+}
+BENCHMARK(BM_IsBipartite);
+
+void BM_NoBetterSolutionPossible(benchmark::State & bench_state) {
+    auto instance = loadInstance<Vertices64>(MICROBENCH_INPUT);
+    SolutionState<Vertices64> state = stateAtDepth(*instance, int(bench_state.range(0)));
+    ProblemInstanceAccess::bestState(*instance).cost = 3984;
+    for (auto _ : bench_state)
+        benchmark::DoNotOptimize(ProblemInstanceAccess::noBetterSolutionPossible(*instance, state));
+}
+BENCHMARK(BM_NoBetterSolutionPossible)->Arg(0)->Arg(30);
+
+// Branching of the subtree under the state at the depth, the best cost starts just below the optimum, so every
+// iteration searches the same tree
+void BM_FindBestStateDFS(benchmark::State & bench_state) {
+    auto instance = loadInstance<Vertices64>(MICROBENCH_INPUT);
+    SolutionState<Vertices64> state = stateAtDepth(*instance, int(bench_state.range(0)));
+    SolutionState<Vertices64> & best_state = ProblemInstanceAccess::bestState(*instance);
+    for (auto _ : bench_state) {
+        best_state.cost = 3984 - 1;
+        ProblemInstanceAccess::findBestStateDFS(*instance, state);
+        benchmark::DoNotOptimize(best_state.cost);
+    }
+}
+BENCHMARK(BM_FindBestStateDFS)->Arg(0)->Arg(10)->Arg(20)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -8,21 +8,38 @@
 #include <cstring>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
 #include <filesystem>
 #include <algorithm>
 #include <utility>
 #include <vector>
+#include <memory>
 #include <unordered_map>
 #include <queue>
+#include <random>
 #include <chrono>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <mpi.h>
+#include <omp.h>
 //----------------------------------------------------------------------------------------------------------------------
-#define MAX_VERTICES 150
-#define MAX_EDGES 11175 // (150 choose 2)
 #define MAX_WEIGHT 120
 #define MIN_WEIGHT 80
+#define BINARY_MAGIC "PDPG" // Instances made by the converter
+#define BINARY_HEADER_SIZE 11
+// Number of open states the search is split into when checkpointing, at most this many otherwise
+#define FRONTIER_SIZE 1024
+#define ESTIMATE_PROBES 32 // Random probes of the size of a work unit
+#define UNITS_PER_WORKER 8 // Work units of about the same estimated size per worker
 // OpenMP number of threads
 int number_of_threads = 1;
+// OpenMP tasks are spawned only for the top levels of a worker's subtree
+#define TASK_DEPTH 8
 // MPI Main process id
 #define MPI_MAIN 0
 // MPI Tags
@@ -30,21 +47,211 @@ int number_of_threads = 1;
 #define TAG_GRAPH 1
 #define TAG_STATE 2
 #define TAG_BEST 3
+#define TAG_COUNTERS 4
 //----------------------------------------------------------------------------------------------------------------------
 using namespace std;
 namespace fs = std::filesystem;
 using time_point = chrono::high_resolution_clock::time_point;
+// Checkpointing, done by the main process
+string checkpoint_path;
+int checkpoint_interval = 60; // seconds
+bool resume = false;
+// Anytime mode, read by every rank
+int time_limit = 0; // seconds, 0 = no limit
+time_point deadline;
+atomic<bool> time_is_up{false};
+// Statistics
+bool print_stats = false; // Print the search counters as JSON
+int progress_interval = 0; // Seconds between the progress reports, 0 = off
+string progress_path; // Status file with the last progress report, standard error if empty
+// Machine readable output, the records go to the standard output and the text to the standard error
+string output_format = "text"; // text, json or csv
+ostream record_output(cout.rdbuf());
+
+bool timeIsUp() {
+    static thread_local uint32_t calls = 0;
+    // Reading the clock on every call would slow down the search
+    if (time_limit > 0 and !time_is_up.load(memory_order_relaxed) and (++calls & 1023) == 0)
+        time_is_up = chrono::high_resolution_clock::now() >= deadline;
+    return time_is_up.load(memory_order_relaxed);
+}
+//----------------------------------------------------------------------------------------------------------------------
+// Progress of the running search, read by the progress reporter from its own thread. The searches publish their nodes
+// in batches and their improvements with relaxed atomic stores, the reporter never reads the fields they work on.
+struct SearchProgress {
+    static constexpr uint64_t NODES_BATCH = 1024;
+    atomic<uint64_t> nodes{0};
+    atomic<uint32_t> best_cost{0};
+    atomic<bool> costs_of_graph{true}; // False while a part of the graph is searched, its costs are not the graph's
+
+    void reset() {
+        nodes.store(0, memory_order_relaxed);
+        best_cost.store(0, memory_order_relaxed);
+        costs_of_graph.store(true, memory_order_relaxed);
+    }
+
+    // Keeps the largest cost, the threads may publish their costs out of order
+    void improve(uint32_t cost) {
+        uint32_t best = best_cost.load(memory_order_relaxed);
+        while (costs_of_graph.load(memory_order_relaxed) and cost > best
+               and !best_cost.compare_exchange_weak(best, cost, memory_order_relaxed)) {
+        }
+    }
+
+    // Hides the costs of a part of the graph until restore, returns the previous state for it
+    bool hideCosts() {
+        return costs_of_graph.exchange(false, memory_order_relaxed);
+    }
+
+    void restore(bool previous) {
+        costs_of_graph.store(previous, memory_order_relaxed);
+    }
+};
+SearchProgress search_progress;
+
+// Search counters of one thread. Every thread counts into its own cache line, so the threads do not slow each
+// other down, and the counters are summed after the search.
+struct alignas(64) SearchCounters {
+    uint64_t nodes = 0;
+    uint64_t leaves = 0;
+    uint64_t weight_prunes = 0;     // The remaining weight cannot beat the best cost
+    uint64_t edge_count_prunes = 0; // Too few remaining edges to connect all vertices
+    uint64_t improvements = 0;
+    uint64_t tasks = 0;
+
+    SearchCounters & operator += (const SearchCounters & other) {
+        nodes += other.nodes;
+        leaves += other.leaves;
+        weight_prunes += other.weight_prunes;
+        edge_count_prunes += other.edge_count_prunes;
+        improvements += other.improvements;
+        tasks += other.tasks;
+        return *this;
+    }
+
+    string toString() const {
+        ostringstream oss;
+        oss << nodes << " " << leaves << " " << weight_prunes << " " << edge_count_prunes << " " << improvements << " " << tasks;
+        return oss.str();
+    }
+
+    void fromString(const string & input) {
+        istringstream iss(input);
+        iss >> nodes >> leaves >> weight_prunes >> edge_count_prunes >> improvements >> tasks;
+    }
+
+    // Counts a node, every NODES_BATCH nodes of the counters are published to the progress reporter
+    void countNode() {
+        if (++nodes % SearchProgress::NODES_BATCH == 0)
+            search_progress.nodes.fetch_add(SearchProgress::NODES_BATCH, memory_order_relaxed);
+    }
+
+    void countImprovement(uint32_t cost) {
+        improvements++;
+        search_progress.improve(cost);
+    }
+
+    void printJson(double seconds, int threads) const {
+        cout << "{\"nodes\": " << nodes
+             << ", \"nodes_per_second\": " << uint64_t(seconds > 0 ? double(nodes) / seconds : 0.0)
+             << ", \"leaves\": " << leaves
+             << ", \"weight_prunes\": " << weight_prunes
+             << ", \"edge_count_prunes\": " << edge_count_prunes
+             << ", \"improvements\": " << improvements
+             << ", \"tasks\": " << tasks
+             << ", \"threads\": " << threads << "}" << endl;
+    }
+};
 //----------------------------------------------------------------------------------------------------------------------
 enum color_t : uint8_t {NO_COLOR = 0, RED = 1, BLUE = 2};
+
+// Vertex count classes, every input is solved with the smallest one it fits in
+struct Vertices64 {
+    static constexpr int max_vertices = 64;
+    static constexpr int max_edges = 2016; // 64 choose 2
+    using vertex_t = uint8_t;
+    using edge_index_t = uint16_t;
+};
+
+struct Vertices150 {
+    static constexpr int max_vertices = 150;
+    static constexpr int max_edges = 11175; // 150 choose 2
+    using vertex_t = uint8_t;
+    using edge_index_t = uint16_t;
+};
+
+struct Vertices1024 {
+    static constexpr int max_vertices = 1024;
+    static constexpr int max_edges = 523776; // 1024 choose 2
+    using vertex_t = uint16_t;
+    using edge_index_t = int32_t;
+};
 class Format;
 class MyMpi; // MPI Sending and receive
-class Edge;
-class Graph;
-class SolutionState;
-class ProblemInstance; // MPI Main
-class Worker;          // MPI Worker
+template <typename V> class Edge;
+template <typename V> class Graph;
+template <typename V> class SolutionState;
+template <typename V> class Checkpoint;
+class Instance;
+template <typename V> class ProblemInstance; // MPI Main
+template <typename V> class Worker;          // MPI Worker
 class InputHandler;
 //----------------------------------------------------------------------------------------------------------------------
+// Result of one instance for --output json or csv
+struct ResultRecord {
+    string backend;
+    string input;
+    int vertices = 0;
+    int edges = 0;
+    uint32_t cost = 0;
+    vector<int> red;
+    vector<int> blue;
+    int64_t elapsed_us = 0;
+    uint64_t nodes = 0;
+    int threads = 1;
+    int ranks = 1;
+
+    static string joined(const vector<int> & vertices, const string & separator) {
+        ostringstream oss;
+        for (size_t i = 0; i < vertices.size(); i++)
+            oss << (i > 0 ? separator : "") << vertices[i];
+        return oss.str();
+    }
+
+    static string quoted(const string & text) {
+        string escaped = "\"";
+        for (char c : text) {
+            if (c == '"' or c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped + "\"";
+    }
+
+    void print(ostream & out) const {
+        if (output_format == "json") {
+            out << "{\"backend\": " << quoted(backend) << ", \"input\": " << quoted(input)
+                << ", \"vertices\": " << vertices << ", \"edges\": " << edges << ", \"cost\": " << cost
+                << ", \"red\": [" << joined(red, ", ") << "], \"blue\": [" << joined(blue, ", ") << "]"
+                << ", \"elapsed_us\": " << elapsed_us << ", \"nodes\": " << nodes
+                << ", \"threads\": " << threads << ", \"ranks\": " << ranks << "}" << endl;
+        } else if (output_format == "csv") {
+            static bool header_printed = false;
+            if (!header_printed) {
+                out << "backend,input,vertices,edges,cost,red,blue,elapsed_us,nodes,threads,ranks" << endl;
+                header_printed = true;
+            }
+            // CSV quotes are doubled, not escaped
+            string input_field = input;
+            for (size_t i = 0; (i = input_field.find('"', i)) != string::npos; i += 2)
+                input_field.insert(i, 1, '"');
+            out << backend << ",\"" << input_field << "\"," << vertices << "," << edges << "," << cost << ","
+                << joined(red, " ") << "," << joined(blue, " ") << "," << elapsed_us << "," << nodes << ","
+                << threads << "," << ranks << endl;
+        }
+    }
+};
+//----------------------------------------------------------------------------------------------------------------------
 class Format {
 public:
     static string elapsedTime(time_point start_time, time_point end_time) {
@@ -56,11 +263,87 @@ public:
         auto s = chrono::duration_cast<chrono::seconds>(ms);
         ms -= chrono::duration_cast<chrono::milliseconds>(s);
         ostringstream oss;
-        oss << h.count() << "h:" << m.count() << "m:" << s.count() << "." << ms.count() << "s";
+        oss << h.count() << "h:" << m.count() << "m:" << s.count() << "." << setw(3) << setfill('0') << ms.count() << "s";
         return oss.str();
     }
 };
 //----------------------------------------------------------------------------------------------------------------------
+// Numbers of a running search read by the progress reporter
+struct ProgressSample {
+    uint64_t nodes = 0;
+    uint32_t best_cost = 0;
+    size_t units_done = 0;  // Finished states of the frontier
+    size_t units_total = 0; // 0 if the search has no frontier
+};
+
+// Writes the progress of a running search every progress_interval seconds from its own thread. The search never
+// waits for it, the reports are read from search_progress, so a report is a snapshot that may be a moment old.
+class ProgressReporter {
+private:
+    string input_name;
+    function<ProgressSample()> sample;
+    time_point start_time;
+    atomic<bool> stopping{false};
+    thread reporter;
+
+    void report(uint64_t & last_nodes, time_point & last_time) {
+        ProgressSample progress = sample();
+        auto now = chrono::high_resolution_clock::now();
+        double interval = chrono::duration<double>(now - last_time).count();
+        uint64_t new_nodes = progress.nodes > last_nodes ? progress.nodes - last_nodes : 0;
+        last_nodes = progress.nodes;
+        last_time = now;
+        ostringstream oss;
+        oss << "Progress of " << input_name << ": " << Format::elapsedTime(start_time, now)
+            << ", nodes " << progress.nodes
+            << " (" << (interval > 0 ? uint64_t(double(new_nodes) / interval) : 0) << "/s)"
+            << ", best " << progress.best_cost;
+        // The units of the frontier are about the same size, the rest takes as long per unit as the done ones
+        if (progress.units_total > 0) {
+            double done = double(progress.units_done) / double(progress.units_total);
+            oss << ", frontier " << progress.units_done << "/" << progress.units_total
+                << " (" << fixed << setprecision(1) << 100.0 * done << " %)";
+            if (progress.units_done > 0) {
+                auto remaining = chrono::duration<double>(now - start_time) * ((1.0 - done) / done);
+                oss << ", ETA " << Format::elapsedTime(now, now + chrono::duration_cast<time_point::duration>(remaining));
+            }
+        }
+        if (progress_path.empty()) {
+            cerr << oss.str() << endl;
+            return;
+        }
+        // The status file always holds a whole report
+        string temporary_path = progress_path + ".tmp";
+        {
+            ofstream status_file(temporary_path, ios::trunc);
+            status_file << oss.str() << endl;
+        }
+        error_code error;
+        fs::rename(temporary_path, progress_path, error);
+    }
+public:
+    ProgressReporter(const string & input_name, function<ProgressSample()> sample)
+        : input_name(input_name), sample(move(sample)), start_time(chrono::high_resolution_clock::now()) {
+        reporter = thread([this] {
+            uint64_t last_nodes = 0;
+            time_point last_time = start_time;
+            time_point next_report = start_time + chrono::seconds(progress_interval);
+            while (!stopping.load()) {
+                this_thread::sleep_for(chrono::milliseconds(100));
+                if (chrono::high_resolution_clock::now() < next_report)
+                    continue;
+                report(last_nodes, last_time);
+                next_report += chrono::seconds(progress_interval);
+            }
+        });
+    }
+
+    ~ProgressReporter() {
+        stopping = true;
+        reporter.join();
+    }
+};
+//----------------------------------------------------------------------------------------------------------------------
 class MyMpi {
 public:
     static void sendString (const int & dest, const int & tag, const string & message) {
@@ -88,10 +371,11 @@ public:
     }
 };
 //----------------------------------------------------------------------------------------------------------------------
+template <typename V>
 class Edge {
 public:
-    uint8_t u; // < 150
-    uint8_t v; // < 150
+    typename V::vertex_t u;
+    typename V::vertex_t v;
     uint8_t weight; // 80 <= weight <= 120
 public:
     Edge() {
@@ -122,42 +406,50 @@ public:
         return oss.str();
     }
 };
+
+// Edges as read from the input, before the instance size is known
+using InputEdge = Edge<Vertices1024>;
 //----------------------------------------------------------------------------------------------------------------------
+template <typename V>
 class Graph {
 public:
-    Edge edges[MAX_EDGES];
-    uint16_t edges_size = 0; // < 11175 = (150 choose 2)
+    Edge<V> edges[V::max_edges];
+    typename V::edge_index_t edges_size = 0;
+    typename V::vertex_t num_of_vertices = 0;
 public:
+    // The vertex count goes first, the workers pick the worker size by it
     string toString() {
         ostringstream oss;
-        for (auto & edge : edges)
-            oss << int(edge.u) << " " << int(edge.v) << " " << int(edge.weight) << " ";
-        oss << int(edges_size);
+        oss << int(num_of_vertices) << " " << int(edges_size);
+        for (int i = 0; i < edges_size; i++)
+            oss << " " << int(edges[i].u) << " " << int(edges[i].v) << " " << int(edges[i].weight);
         return oss.str();
     }
 
     void fromString(const string& input) {
-        int u, v, w, size;
+        int n, u, v, w, size;
         istringstream iss(input);
-        for (auto & edge : edges){
-            iss >> u;   edge.u = u;
-            iss >> v;   edge.v = v;
-            iss >> w;   edge.weight = w;
-        }
+        iss >> n;       num_of_vertices = n;
         iss >> size;    edges_size = size;
+        for (int i = 0; i < edges_size; i++) {
+            iss >> u;   edges[i].u = u;
+            iss >> v;   edges[i].v = v;
+            iss >> w;   edges[i].weight = w;
+        }
     }
 };
 //----------------------------------------------------------------------------------------------------------------------
+template <typename V>
 class SolutionState {
 public:
-    color_t colors[MAX_VERTICES] = {NO_COLOR};
-    uint8_t num_of_vertices = 0;        // < 150
-    uint16_t edge_index = 0;            // < 11175 = (150 choose 2)
-    uint16_t used_edges = 0;            // < 11175 = (150 choose 2)
-    uint32_t cost = 0;                  // < 1341000 = 11175 * 120
-    uint32_t sum_cost_all = 0;          // < 1341000 = 11175 * 120
-    uint32_t edges_total_weight = 0;    // < 1341000 = 11175 * 120
-    Graph * graph = nullptr;
+    color_t colors[V::max_vertices] = {NO_COLOR};
+    typename V::vertex_t num_of_vertices = 0;
+    typename V::edge_index_t edge_index = 0;
+    typename V::edge_index_t used_edges = 0;
+    uint32_t cost = 0;
+    uint32_t sum_cost_all = 0;
+    uint32_t edges_total_weight = 0;
+    Graph<V> * graph = nullptr;
 public:
     string toString() {
         ostringstream oss;
@@ -172,7 +464,7 @@ public:
         return oss.str();
     }
 
-    void fromString(const string& input, Graph * graph_ptr) {
+    void fromString(const string& input, Graph<V> * graph_ptr) {
         int int_color, int_num_of_vertices, int_edge_index, int_used_edges, int_cost, int_sum_cost_all, int_edges_total_weight;
         istringstream iss(input);
         for (auto & color : colors) {
@@ -232,28 +524,29 @@ public:
         return true;
     }
 
-    void isConnectedDFS(const uint8_t (& adj_map)[MAX_VERTICES][MAX_VERTICES], const uint8_t (& adj_map_sizes)[MAX_VERTICES], uint8_t v, bool (& visited)[MAX_VERTICES]) {
-        visited[v] = true;
-        for (int i = 0; i < adj_map_sizes[v]; i++)
-            if (!visited[adj_map[v][i]])
-                isConnectedDFS(adj_map, adj_map_sizes, adj_map[v][i], visited);
+    // Union-find with path halving, an adjacency matrix would not fit on the stack for larger graphs
+    static int findRoot(typename V::vertex_t (& parent)[V::max_vertices], int v) {
+        while (parent[v] != v) {
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
     }
 
     bool isConnected() {
-        uint8_t adj_map[MAX_VERTICES][MAX_VERTICES] = {{0}};
-        uint8_t adj_map_sizes[MAX_VERTICES] = {0};
+        typename V::vertex_t parent[V::max_vertices];
+        for (int i = 0; i < num_of_vertices; i++)
+            parent[i] = i;
+        int components = num_of_vertices;
         for (int i = 0; i < graph->edges_size; i++) {
-            adj_map[graph->edges[i].u][adj_map_sizes[graph->edges[i].u]] = graph->edges[i].v;
-            adj_map_sizes[graph->edges[i].u]++;
-            adj_map[graph->edges[i].v][adj_map_sizes[graph->edges[i].v]] = graph->edges[i].u;
-            adj_map_sizes[graph->edges[i].v]++;
-        }
-        bool visited[MAX_VERTICES] = {false};
-        isConnectedDFS(adj_map, adj_map_sizes, 0, visited);
-        for (int i = 0; i < num_of_vertices; ++i)
-            if (!visited[i])
-                return false;
-        return true;
+            int root_u = findRoot(parent, graph->edges[i].u);
+            int root_v = findRoot(parent, graph->edges[i].v);
+            if (root_u != root_v) {
+                parent[root_u] = root_v;
+                components--;
+            }
+        }
+        return components <= 1;
     }
 
     [[nodiscard]] uint32_t sumWeightRemainingEdges() const {
@@ -285,26 +578,162 @@ public:
     }
 };
 //----------------------------------------------------------------------------------------------------------------------
-class ProblemInstance {
+template <typename V>
+class Checkpoint {
+    // Binary layout (native byte order):
+    //   "PDPC", name length (u16), input name, num_of_vertices (u16), edges_size (u32),
+    //   best state, number of frontier states (u32), frontier states.
+    // A state is edge_index (u32), used_edges (u32), cost (u32), sum_cost_all (u32)
+    // and the colors packed 4 per byte.
 private:
-    Graph graph;
-    SolutionState initial_state;
-    SolutionState best_state;
+    template<typename T>
+    static void write(ofstream & out, T value) {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    static T read(ifstream & in) {
+        T value{};
+        in.read(reinterpret_cast<char *>(&value), sizeof(value));
+        return value;
+    }
+
+    static void writeState(ofstream & out, const SolutionState<V> & state) {
+        write(out, uint32_t(state.edge_index));
+        write(out, uint32_t(state.used_edges));
+        write(out, state.cost);
+        write(out, state.sum_cost_all);
+        for (int i = 0; i < state.num_of_vertices; i += 4) {
+            uint8_t packed = 0;
+            for (int j = 0; j < 4 and i + j < state.num_of_vertices; j++)
+                packed |= state.colors[i + j] << (2 * j);
+            write(out, packed);
+        }
+    }
+
+    // False if the state cannot belong to the instance, the file is corrupt
+    static bool readState(ifstream & in, SolutionState<V> & state, uint32_t edges_size) {
+        uint32_t edge_index = read<uint32_t>(in);
+        uint32_t used_edges = read<uint32_t>(in);
+        if (edge_index > edges_size or used_edges > edge_index)
+            return false;
+        state.edge_index = edge_index;
+        state.used_edges = used_edges;
+        state.cost = read<uint32_t>(in);
+        state.sum_cost_all = read<uint32_t>(in);
+        for (int i = 0; i < state.num_of_vertices; i += 4) {
+            auto packed = read<uint8_t>(in);
+            for (int j = 0; j < 4 and i + j < state.num_of_vertices; j++) {
+                state.colors[i + j] = color_t((packed >> (2 * j)) & 3);
+                if (state.colors[i + j] > BLUE)
+                    return false;
+            }
+        }
+        return bool(in);
+    }
+public:
+    static void save(const string & path, const string & input_name, const Graph<V> & graph, const SolutionState<V> & best_state, const vector<SolutionState<V>> & frontier) {
+        string tmp_path = path + ".tmp";
+        ofstream out(tmp_path, ios::binary | ios::trunc);
+        if (!out.is_open()) {
+            cout << "Error writing checkpoint " << path << endl;
+            return;
+        }
+        string name = fs::path(input_name).filename();
+        out.write("PDPC", 4);
+        write(out, uint16_t(name.size()));
+        out.write(name.data(), streamsize(name.size()));
+        write(out, uint16_t(best_state.num_of_vertices));
+        write(out, uint32_t(graph.edges_size));
+        writeState(out, best_state);
+        write(out, uint32_t(frontier.size()));
+        for (const auto & state : frontier)
+            writeState(out, state);
+        out.close();
+        // Replace the previous checkpoint only once the new one is complete
+        fs::rename(tmp_path, path);
+    }
+
+    // States are read on top of initial_state, so they share its graph. Nothing is changed unless the whole file is valid.
+    static bool load(const string & path, const string & input_name, const SolutionState<V> & initial_state, SolutionState<V> & best_state, vector<SolutionState<V>> & frontier) {
+        ifstream in(path, ios::binary);
+        if (!in.is_open())
+            return false;
+        char magic[4];
+        in.read(magic, 4);
+        if (!in or memcmp(magic, "PDPC", 4) != 0)
+            return false;
+        string name(read<uint16_t>(in), '\0');
+        in.read(&name[0], streamsize(name.size()));
+        if (name != string(fs::path(input_name).filename()))
+            return false;
+        uint16_t num_of_vertices = read<uint16_t>(in);
+        uint32_t edges_size = read<uint32_t>(in);
+        if (num_of_vertices != initial_state.num_of_vertices or edges_size != uint32_t(initial_state.graph->edges_size))
+            return false;
+        SolutionState<V> loaded_best_state = initial_state;
+        if (!readState(in, loaded_best_state, edges_size))
+            return false;
+        // The number of states has to match the rest of the file, so a truncated file is not read past its end
+        uint32_t frontier_size = read<uint32_t>(in);
+        streamoff state_bytes = streamoff(4 * sizeof(uint32_t) + (num_of_vertices + 3) / 4);
+        streamoff position = in.tellg();
+        in.seekg(0, ios::end);
+        streamoff remaining = in.tellg() - position;
+        in.seekg(position);
+        if (!in or remaining != streamoff(frontier_size) * state_bytes)
+            return false;
+        vector<SolutionState<V>> loaded_frontier(frontier_size, initial_state);
+        for (auto & state : loaded_frontier)
+            if (!readState(in, state, edges_size))
+                return false;
+        best_state = loaded_best_state;
+        frontier = std::move(loaded_frontier);
+        return true;
+    }
+};
+//----------------------------------------------------------------------------------------------------------------------
+// Interface of the instances of all sizes
+class Instance {
+public:
+    virtual ~Instance() = default;
+    virtual string getInputName() = 0;
+    [[nodiscard]] virtual uint32_t getBestStateCost() const = 0;
+    virtual void findMaxConnectedBipartiteSubgraph() = 0;
+};
+//----------------------------------------------------------------------------------------------------------------------
+template <typename V>
+class ProblemInstance : public Instance {
+private:
+    Graph<V> graph;
+    SolutionState<V> initial_state;
+    SolutionState<V> best_state;
     // MPI parallelism
-    vector<SolutionState> solution_states_queue;
+    vector<SolutionState<V>> solution_states_queue;
+    atomic<size_t> units_done{0}; // Searched states of the frontier, for the progress reports
+    atomic<size_t> units_total{0};
     int world_size;
+    // Checkpointing
+    vector<SolutionState<V>> worker_states;    // State each worker is searching
+    vector<bool> worker_busy;
+    time_point last_checkpoint_time;
+    // Anytime mode
+    vector<SolutionState<V>> open_states; // States the workers may not have finished before the time limit
+    uint32_t open_bound = 0;           // Best cost the open states can reach
+    vector<uint32_t> triangle_bound;   // Upper bound of the cut of the edges from i to the end, see initTriangleBounds
     // Metrics
     string input_name;
     time_point start_time;
+    SearchCounters counters; // Of the main process and of all the subtrees the workers finished
 private:
     void printResult() {
         auto end_time = chrono::high_resolution_clock::now();
         cout << "============================================" << endl;
         cout << "Result of: " << this->input_name << endl;
         cout << "--------------------------------------------" << endl;
-        vector<uint8_t> reds;
-        vector<uint8_t> blues;
-        for (uint8_t i = 0; i < this->best_state.num_of_vertices; i++)
+        vector<int> reds;
+        vector<int> blues;
+        for (int i = 0; i < this->best_state.num_of_vertices; i++)
             if (this->best_state.colors[i] == RED)
                 reds.push_back(i);
             else
@@ -322,7 +751,7 @@ private:
         }
         cout << "}" << endl;
         cout << "--------------------------------------------" << endl;
-        vector<Edge> used_edges;
+        vector<Edge<V>> used_edges;
         for (int i = 0; i < graph.edges_size; i++)
             if (best_state.colors[graph.edges[i].u] != best_state.colors[graph.edges[i].v])
                 used_edges.push_back(graph.edges[i]);
@@ -335,35 +764,262 @@ private:
         cout << "--------------------------------------------" << endl;
         cout << "Weights sum = " << best_state.cost << endl;
         cout << "--------------------------------------------" << endl;
+        if (time_is_up) {
+            uint32_t upper_bound = max(best_state.cost, open_bound);
+            cout << "Time limit reached, upper bound = " << upper_bound << ", gap = " << upper_bound - best_state.cost << endl;
+            cout << "--------------------------------------------" << endl;
+        }
+        if (print_stats)
+            counters.printJson(chrono::duration<double>(end_time - start_time).count(), (world_size - 1) * number_of_threads);
         cout << "Took: " << Format::elapsedTime(start_time, end_time) << endl;
         cout << "============================================" << endl;
+        printRecord(end_time);
     }
 
-    [[nodiscard]] bool noBetterSolutionPossible(SolutionState state) const {
-        if (state.cost + state.sumWeightRemainingEdges() < best_state.cost)
+    void printRecord(time_point end_time) const {
+        if (output_format == "text")
+            return;
+        ResultRecord record;
+        record.backend = "mpi";
+        record.input = input_name;
+        record.vertices = best_state.num_of_vertices;
+        record.edges = graph.edges_size;
+        record.cost = best_state.cost;
+        for (int i = 0; i < best_state.num_of_vertices; i++)
+            (best_state.colors[i] == RED ? record.red : record.blue).push_back(i);
+        record.elapsed_us = chrono::duration_cast<chrono::microseconds>(end_time - start_time).count();
+        record.nodes = counters.nodes;
+        record.threads = number_of_threads;
+        record.ranks = world_size;
+        record.print(record_output);
+    }
+
+    bool noBetterSolutionPossible(SolutionState<V> state) {
+        if (state.cost + state.sumWeightRemainingEdges() < best_state.cost) {
+            counters.weight_prunes++;
             return true;
-        if (state.numOfUsedEdges() + state.numOfRemainingEdges() < int(state.num_of_vertices - 1))
+        }
+        if (state.numOfUsedEdges() + state.numOfRemainingEdges() < int(state.num_of_vertices - 1)) {
+            counters.edge_count_prunes++;
             return true;
+        }
         return false;
     }
 
     size_t solutionQueueLimit() {
+        // Finer split when checkpointing, a checkpoint never splits a started state
+        if (!checkpoint_path.empty())
+            return max(size_t(world_size * 2), size_t(FRONTIER_SIZE));
         return world_size * 2;
     }
 
+    // Children of the state in the order of findBestStateDFS, returns their number
+    int branchStates(const SolutionState<V> & state, SolutionState<V> * children) const {
+        int u = graph.edges[state.edge_index].u;
+        int v = graph.edges[state.edge_index].v;
+        int num_of_children = 0;
+        for (auto [color_u, color_v] : {pair{RED, BLUE}, pair{BLUE, RED}, pair{RED, RED}, pair{BLUE, BLUE}}) {
+            if ((state.colors[u] != NO_COLOR and state.colors[u] != color_u) or
+                (state.colors[v] != NO_COLOR and state.colors[v] != color_v))
+                continue;
+            SolutionState<V> & child = children[num_of_children++];
+            child = state;
+            if (color_u != color_v)
+                child.addEdge();
+            else
+                child.skipEdge();
+            child.colors[u] = color_u;
+            child.colors[v] = color_v;
+        }
+        return num_of_children;
+    }
+
+    static bool probePruned(const SolutionState<V> & state, uint32_t bound) {
+        return state.cost + state.sumWeightRemainingEdges() < bound or
+               state.numOfUsedEdges() + state.numOfRemainingEdges() < int(state.num_of_vertices - 1);
+    }
+
+    // The first leaf of findBestStateDFS, so the estimates prune with the first bound of the real search
+    void diveFirstBranches(SolutionState<V> state) {
+        SolutionState<V> children[4];
+        while (!state.isLeaf()) {
+            if (probePruned(state, best_state.cost))
+                return;
+            branchStates(state, children);
+            state = children[0];
+        }
+        if (state.isConnected() and state.isBetterThan(best_state))
+            best_state = state;
+    }
+
+    // Knuth's estimate, a random path down the tree counts every level as the product of the branching factors above
+    // it. The leaves on the way raise the bound like they do in the search.
+    double probeSubtreeSize(SolutionState<V> state, uint32_t & bound, mt19937_64 & generator) const {
+        SolutionState<V> children[4];
+        double level_size = 1;
+        double size = 1;
+        while (true) {
+            if (state.isLeaf()) {
+                if (state.isConnected() and state.cost > bound)
+                    bound = state.cost;
+                return size;
+            }
+            if (probePruned(state, bound))
+                return size;
+            int num_of_children = branchStates(state, children);
+            level_size *= num_of_children;
+            size += level_size;
+            state = children[uniform_int_distribution<int>(0, num_of_children - 1)(generator)];
+        }
+    }
+
+    double estimateSubtreeSize(const SolutionState<V> & state, mt19937_64 & generator) const {
+        uint32_t bound = best_state.cost;
+        double sum = 0;
+        for (int i = 0; i < ESTIMATE_PROBES; i++)
+            sum += probeSubtreeSize(state, bound, generator);
+        return sum / ESTIMATE_PROBES;
+    }
+
+    // Splits the largest estimated subtree until every work unit is a small share of the tree
     void generateStatesQueue() {
+        mt19937_64 generator(0x5eed);
+        diveFirstBranches(initial_state);
         this->solution_states_queue.push_back(initial_state);
-        while (solution_states_queue.size() < solutionQueueLimit()) {
-            findBestStateBFS(solution_states_queue.front());
-            solution_states_queue.erase(solution_states_queue.begin());
+        vector<double> subtree_sizes = {estimateSubtreeSize(initial_state, generator)};
+        double unit_size = subtree_sizes[0] / double(size_t(max(world_size - 1, 1)) * UNITS_PER_WORKER);
+        size_t max_queue_size = max(solutionQueueLimit(), size_t(FRONTIER_SIZE));
+        while (!solution_states_queue.empty() and solution_states_queue.size() < max_queue_size) {
+            size_t largest = max_element(subtree_sizes.begin(), subtree_sizes.end()) - subtree_sizes.begin();
+            if (solution_states_queue.size() >= solutionQueueLimit() and subtree_sizes[largest] <= unit_size)
+                break;
+            SolutionState<V> state = solution_states_queue[largest];
+            solution_states_queue.erase(solution_states_queue.begin() + long(largest));
+            subtree_sizes.erase(subtree_sizes.begin() + long(largest));
+            findBestStateBFS(state);
+            while (subtree_sizes.size() < solution_states_queue.size())
+                subtree_sizes.push_back(estimateSubtreeSize(solution_states_queue[subtree_sizes.size()], generator));
         }
     }
 
-    void findBestStateBFS(SolutionState state) {
+    void sendWork(int worker) {
+        worker_states[worker] = solution_states_queue.front();
+        worker_busy[worker] = true;
+        MyMpi::sendString(worker, TAG_STATE, solution_states_queue.front().toString());
+        counters.tasks++;
+        solution_states_queue.erase(solution_states_queue.begin());
+    }
+
+    // Upper bound of the cut of the edges from i to the end. Every triangle has an edge that is not cut, so the lightest
+    // edge of every triangle of an edge disjoint packing is left out of the weight of the suffix. The packing is greedy
+    // from the last edge, the packing of a suffix is the one of the shorter suffix and a triangle of its first edge.
+    void initTriangleBounds() {
+        int n = initial_state.num_of_vertices;
+        vector<int> edge_of(size_t(n) * n, -1);
+        for (int i = 0; i < graph.edges_size; i++)
+            edge_of[graph.edges[i].u * n + graph.edges[i].v] = edge_of[graph.edges[i].v * n + graph.edges[i].u] = i;
+        vector<bool> packed(graph.edges_size, false);
+        triangle_bound.assign(graph.edges_size + 1, 0);
+        uint32_t suffix_weight = 0;
+        uint32_t uncut_weight = 0;
+        for (int i = graph.edges_size - 1; i >= 0; i--) {
+            int u = graph.edges[i].u;
+            int v = graph.edges[i].v;
+            suffix_weight += graph.edges[i].weight;
+            int third = -1;
+            uint32_t lightest = 0;
+            for (int w = 0; w < n; w++) {
+                int a = edge_of[u * n + w];
+                int b = edge_of[v * n + w];
+                if (a <= i or b <= i or packed[a] or packed[b])
+                    continue;
+                uint32_t weight = min({uint32_t(graph.edges[i].weight), uint32_t(graph.edges[a].weight), uint32_t(graph.edges[b].weight)});
+                if (weight > lightest) {
+                    lightest = weight;
+                    third = w;
+                }
+            }
+            if (third >= 0) {
+                packed[i] = packed[edge_of[u * n + third]] = packed[edge_of[v * n + third]] = true;
+                uncut_weight += lightest;
+            }
+            triangle_bound[i] = suffix_weight - uncut_weight;
+        }
+    }
+
+    // Best cost an open state can reach by its remaining edges, the triangle bound is much tighter than their weight
+    uint32_t openStateBound(const SolutionState<V> & state) {
+        if (triangle_bound.empty())
+            initTriangleBounds();
+        return state.cost + min(state.sumWeightRemainingEdges(), triangle_bound[state.edge_index]);
+    }
+
+    MPI_Status receiveResult() {
+        SolutionState<V> potential_new_best;
+        string potential_new_best_str;
+        MPI_Status status = MyMpi::recvString(MPI_ANY_SOURCE, TAG_BEST, potential_new_best_str);
+        potential_new_best.fromString(potential_new_best_str, &graph);
+        worker_busy[status.MPI_SOURCE] = false;
+        // The counters of the subtree follow its result
+        string worker_counters_str;
+        MyMpi::recvString(status.MPI_SOURCE, TAG_COUNTERS, worker_counters_str);
+        SearchCounters worker_counters;
+        worker_counters.fromString(worker_counters_str);
+        counters += worker_counters;
+        // The nodes of the workers are published when their results arrive
+        search_progress.nodes.fetch_add(worker_counters.nodes, memory_order_relaxed);
+        units_done++;
+        if (deadlineReached())
+            open_states.push_back(worker_states[status.MPI_SOURCE]);
+        if (potential_new_best.isBetterThan(best_state)) {
+            best_state = potential_new_best;
+            search_progress.improve(best_state.cost);
+            if (time_limit > 0)
+                printImprovement();
+        } else if (!solution_states_queue.empty()) {
+            // Share the incumbent with the worker
+            MyMpi::sendString(status.MPI_SOURCE, TAG_BEST, best_state.toString());
+        }
+        if (!checkpoint_path.empty())
+            saveCheckpoint();
+        return status;
+    }
+
+    [[nodiscard]] static bool deadlineReached() {
+        return time_limit > 0 and chrono::high_resolution_clock::now() >= deadline;
+    }
+
+    void printImprovement() {
+        auto now = chrono::high_resolution_clock::now();
+        cout << "Improved: " << best_state.cost << " after " << Format::elapsedTime(start_time, now) << " colors: ";
+        for (int i = 0; i < best_state.num_of_vertices; i++)
+            cout << (best_state.colors[i] == RED ? 'R' : 'B');
+        cout << endl;
+    }
+
+    void saveCheckpoint() {
+        auto now = chrono::high_resolution_clock::now();
+        if (now - last_checkpoint_time < chrono::seconds(checkpoint_interval))
+            return;
+        // States still being searched by the workers are saved as open
+        vector<SolutionState<V>> frontier = solution_states_queue;
+        for (int i = 1; i < world_size; i++)
+            if (worker_busy[i])
+                frontier.push_back(worker_states[i]);
+        Checkpoint<V>::save(checkpoint_path, input_name, graph, best_state, frontier);
+        last_checkpoint_time = now;
+    }
+
+    void findBestStateBFS(SolutionState<V> state) {
         // Check if better solution found
+        counters.countNode();
         if (state.isLeaf()) {
+            counters.leaves++;
             if (state.isConnected() and state.isBetterThan(best_state)) {
                 best_state = state;
+                counters.countImprovement(state.cost);
+                if (time_limit > 0)
+                    printImprovement();
                 return;
             } else {
                 return;
@@ -378,34 +1034,34 @@ private:
         if ((state.colors[u] == RED and state.colors[v] == RED) or
             (state.colors[u] == BLUE and state.colors[v] == BLUE)){
             {
-                SolutionState opt_skip = state;
+                SolutionState<V> opt_skip = state;
                 opt_skip.skipEdge();
                 solution_states_queue.push_back(opt_skip);
             }
         } else if (state.colors[u] == NO_COLOR and state.colors[v] == NO_COLOR) {
             {
-                SolutionState opt_add_red_blue = state;
+                SolutionState<V> opt_add_red_blue = state;
                 opt_add_red_blue.addEdge();
                 opt_add_red_blue.colors[u] = RED;
                 opt_add_red_blue.colors[v] = BLUE;
                 solution_states_queue.push_back(opt_add_red_blue);
             }
             {
-                SolutionState opt_add_blue_red = state;
+                SolutionState<V> opt_add_blue_red = state;
                 opt_add_blue_red.addEdge();
                 opt_add_blue_red.colors[u] = BLUE;
                 opt_add_blue_red.colors[v] = RED;
                 solution_states_queue.push_back(opt_add_blue_red);
             }
             {
-                SolutionState opt_skip_red_red = state;
+                SolutionState<V> opt_skip_red_red = state;
                 opt_skip_red_red.skipEdge();
                 opt_skip_red_red.colors[u] = RED;
                 opt_skip_red_red.colors[v] = RED;
                 solution_states_queue.push_back(opt_skip_red_red);
             }
             {
-                SolutionState opt_skip_blue_blue = state;
+                SolutionState<V> opt_skip_blue_blue = state;
                 opt_skip_blue_blue.skipEdge();
                 opt_skip_blue_blue.colors[u] = BLUE;
                 opt_skip_blue_blue.colors[v] = BLUE;
@@ -414,13 +1070,13 @@ private:
         } else if ((state.colors[u] == RED and state.colors[v] == NO_COLOR) or
                    (state.colors[u] == BLUE and state.colors[v] == NO_COLOR)) {
             {
-                SolutionState opt_add_opposite = state;
+                SolutionState<V> opt_add_opposite = state;
                 opt_add_opposite.addEdge();
-                opt_add_opposite.colors[v] = SolutionState::getOppositeColor(opt_add_opposite.colors[u]);
+                opt_add_opposite.colors[v] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[u]);
                 solution_states_queue.push_back(opt_add_opposite);
             }
             {
-                SolutionState opt_skip_same = state;
+                SolutionState<V> opt_skip_same = state;
                 opt_skip_same.skipEdge();
                 opt_skip_same.colors[v] = opt_skip_same.colors[u];
                 solution_states_queue.push_back(opt_skip_same);
@@ -428,13 +1084,13 @@ private:
         } else if ((state.colors[u] == NO_COLOR and state.colors[v] == RED) or
                    (state.colors[u] == NO_COLOR and state.colors[v] == BLUE)) {
             {
-                SolutionState opt_add_opposite = state;
+                SolutionState<V> opt_add_opposite = state;
                 opt_add_opposite.addEdge();
-                opt_add_opposite.colors[u] = SolutionState::getOppositeColor(opt_add_opposite.colors[v]);
+                opt_add_opposite.colors[u] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[v]);
                 solution_states_queue.push_back(opt_add_opposite);
             }
             {
-                SolutionState opt_skip_same = state;
+                SolutionState<V> opt_skip_same = state;
                 opt_skip_same.skipEdge();
                 opt_skip_same.colors[u] = opt_skip_same.colors[v];
                 solution_states_queue.push_back(opt_skip_same);
@@ -442,106 +1098,172 @@ private:
         } else if ((state.colors[u] == RED and state.colors[v] == BLUE) or
                    (state.colors[u] == BLUE and state.colors[v] == RED)) {
             {
-                SolutionState opt_add = state;
+                SolutionState<V> opt_add = state;
                 opt_add.addEdge();
                 solution_states_queue.push_back(opt_add);
             }
         }
     }
 public:
-    ProblemInstance(string input_name, int num_of_vertices, vector<Edge> edges) {
-        for (graph.edges_size = 0; graph.edges_size < min(sizeof(this->graph.edges), edges.size()); graph.edges_size++) {
-            this->graph.edges[graph.edges_size] = edges[graph.edges_size];
+    ProblemInstance(string input_name, int num_of_vertices, const vector<InputEdge> & edges) {
+        // Inputs are dispatched by their size, so all the edges fit
+        for (graph.edges_size = 0; size_t(graph.edges_size) < min<size_t>(V::max_edges, edges.size()); graph.edges_size++) {
+            this->graph.edges[graph.edges_size] = Edge<V>(edges[graph.edges_size].u, edges[graph.edges_size].v, edges[graph.edges_size].weight);
             this->initial_state.edges_total_weight += edges[graph.edges_size].weight;
         }
-        sort(this->graph.edges, this->graph.edges + graph.edges_size, greater<>());
+        // Binary inputs are sorted already
+        if (!is_sorted(this->graph.edges, this->graph.edges + graph.edges_size, greater<>()))
+            sort(this->graph.edges, this->graph.edges + graph.edges_size, greater<>());
         initial_state.num_of_vertices = num_of_vertices;
+        graph.num_of_vertices = num_of_vertices;
         best_state = this->initial_state;
         world_size = 0;
         this->input_name = std::move(input_name);
     }
 
-    string getInputName() {
+    string getInputName() override {
         return input_name;
     }
 
-    [[nodiscard]] uint32_t getBestStateCost() const {
+    [[nodiscard]] uint32_t getBestStateCost() const override {
         return best_state.cost;
     }
 
-    void findMaxConnectedBipartiteSubgraph() {
+    // Called by the progress reporter while the search runs
+    ProgressSample progressSample() const {
+        ProgressSample sample;
+        sample.nodes = search_progress.nodes.load(memory_order_relaxed);
+        sample.best_cost = search_progress.best_cost.load(memory_order_relaxed);
+        sample.units_done = units_done.load(memory_order_relaxed);
+        sample.units_total = units_total.load(memory_order_relaxed);
+        return sample;
+    }
+
+    void findMaxConnectedBipartiteSubgraph() override {
         start_time = chrono::high_resolution_clock::now();
+        deadline = start_time + chrono::seconds(time_limit);
+        time_is_up = false;
         initial_state.graph = &this->graph;
+        // Reports until the result is printed
+        unique_ptr<ProgressReporter> progress_reporter;
+        search_progress.reset();
+        if (progress_interval > 0)
+            progress_reporter = make_unique<ProgressReporter>(input_name, [this] { return progressSample(); });
+
+        MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+        // Send graph to all workers
+        for (int i = 1; i < world_size; i++) {
+            MyMpi::sendString(i, TAG_GRAPH, graph.toString());
+        }
         if (initial_state.isBipartite() and initial_state.isConnected()) {
             best_state = initial_state;
+            // Every edge is cut
+            best_state.edge_index = best_state.used_edges = graph.edges_size;
+            best_state.cost = best_state.sum_cost_all = best_state.edges_total_weight;
+            // Release the workers, there is nothing to search
+            SolutionState<V> no_work;
+            for (int i = 1; i < world_size; i++)
+                MyMpi::sendString(i, TAG_STATE, no_work.toString());
         } else {
             initial_state.resetSolution();
-            MPI_Comm_size(MPI_COMM_WORLD, &world_size);
-            generateStatesQueue();
-            // Send graph to all workers
-            for (int i = 1; i < world_size; i++) {
-                MyMpi::sendString(i, TAG_GRAPH, graph.toString());
+            if (resume and Checkpoint<V>::load(checkpoint_path, input_name, initial_state, best_state, solution_states_queue)) {
+                cout << "Resumed from " << checkpoint_path << ", open states: " << solution_states_queue.size() << endl;
+            } else {
+                if (resume)
+                    cout << "No valid checkpoint for " << input_name << " in " << checkpoint_path << ", starting from scratch." << endl;
+                generateStatesQueue();
             }
+            units_total = solution_states_queue.size();
+            worker_states.assign(world_size, SolutionState<V>());
+            worker_busy.assign(world_size, false);
+            last_checkpoint_time = chrono::high_resolution_clock::now();
             // Send work
             int running_workers = 1;
-            while (!solution_states_queue.empty()) {
+            while (!solution_states_queue.empty() and !deadlineReached()) {
                 if (running_workers < world_size) {
-                    MyMpi::sendString(running_workers, TAG_STATE, solution_states_queue.front().toString());
-                    solution_states_queue.erase(solution_states_queue.begin());
+                    sendWork(running_workers);
                     running_workers++;
                 } else {
-                    SolutionState potential_new_best;
-                    string potential_new_best_str;
-                    MPI_Status status = MyMpi::recvString(MPI_ANY_SOURCE, TAG_BEST, potential_new_best_str);
-                    potential_new_best.fromString(potential_new_best_str, &graph);
-                    if (potential_new_best.isBetterThan(best_state)) {
-                        best_state = potential_new_best;
-                    } else {
-                        MyMpi::sendString(status.MPI_SOURCE, TAG_STATE, best_state.toString());
-                    }
-                    MyMpi::sendString(status.MPI_SOURCE, TAG_STATE, solution_states_queue.front().toString());
-                    solution_states_queue.erase(solution_states_queue.begin());
+                    MPI_Status status = receiveResult();
+                    if (!deadlineReached())
+                        sendWork(status.MPI_SOURCE);
                 }
             }
-            while (running_workers > 1) {
-                SolutionState potential_new_best;
-                string potential_new_best_str;
-                MPI_Status status;
-                status = MyMpi::recvString(MPI_ANY_SOURCE, TAG_BEST, potential_new_best_str);
-                potential_new_best.fromString(potential_new_best_str, &graph);
-                if (potential_new_best.isBetterThan(best_state))
-                    best_state = potential_new_best;
-                MyMpi::sendString(running_workers - 1, TAG_STATE, initial_state.toString());
-                running_workers--;
+            // Collect the remaining results and stop the workers
+            while (any_of(worker_busy.begin(), worker_busy.end(), [](bool busy){return busy;}))
+                receiveResult();
+            for (int i = 1; i < world_size; i++)
+                MyMpi::sendString(i, TAG_STATE, initial_state.toString());
+            // States left by the time limit
+            open_states.insert(open_states.end(), solution_states_queue.begin(), solution_states_queue.end());
+            time_is_up = !open_states.empty();
+            if (time_is_up) {
+                for (auto & state : open_states)
+                    open_bound = max(open_bound, openStateBound(state));
+                // Keep the open states, the search can be resumed with more time
+                if (!checkpoint_path.empty())
+                    Checkpoint<V>::save(checkpoint_path, input_name, graph, best_state, open_states);
+            } else if (!checkpoint_path.empty()) {
+                // The checkpoint always belongs to the instance in progress
+                fs::remove(checkpoint_path);
             }
         }
+        progress_reporter.reset();
         printResult();
     }
 };
 
 //----------------------------------------------------------------------------------------------------------------------
+template <typename V>
 class Worker {
 private:
-    Graph graph;
-    SolutionState initial_state;
-    SolutionState best_state;
+    Graph<V> graph;
+    SolutionState<V> initial_state;
+    SolutionState<V> best_state;
+    atomic<uint32_t> best_cost{0}; // Cost of best_state, readable without the critical section
+    vector<SearchCounters> thread_counters; // Of the subtree in progress
 private:
-    [[nodiscard]] bool noBetterSolutionPossible(SolutionState state) const {
-        if (state.cost + state.sumWeightRemainingEdges() < best_state.cost)
+    SearchCounters & threadCounters() {
+        return thread_counters[omp_get_thread_num()];
+    }
+
+    bool noBetterSolutionPossible(SolutionState<V> state) {
+        if (state.cost + state.sumWeightRemainingEdges() < best_cost.load(memory_order_relaxed)) {
+            threadCounters().weight_prunes++;
             return true;
-        if (state.numOfUsedEdges() + state.numOfRemainingEdges() < int(state.num_of_vertices - 1))
+        }
+        if (state.numOfUsedEdges() + state.numOfRemainingEdges() < int(state.num_of_vertices - 1)) {
+            threadCounters().edge_count_prunes++;
             return true;
+        }
         return false;
     }
 
-    void findBestStateDFS(SolutionState state) {
+    void explore(SolutionState<V> state, int depth) {
+        if (depth < TASK_DEPTH) {
+            threadCounters().tasks++;
+            #pragma omp task
+            findBestStateDFS(state, depth + 1);
+        } else {
+            findBestStateDFS(state, depth + 1);
+        }
+    }
+
+    void findBestStateDFS(SolutionState<V> state, int depth) {
+        if (timeIsUp())
+            return;
         // Check if better solution found
+        threadCounters().countNode();
         if (state.isLeaf()) {
-            if (state.isConnected() and state.isBetterThan(best_state)) {
-                //#pragma omp critical
+            threadCounters().leaves++;
+            if (state.isConnected() and state.cost > best_cost.load(memory_order_relaxed)) {
+                #pragma omp critical
                 {
-                    if(state.isBetterThan(best_state))
+                    if(state.isBetterThan(best_state)) {
                         best_state = state;
+                        best_cost.store(state.cost, memory_order_relaxed);
+                        threadCounters().countImprovement(state.cost);
+                    }
                 }
                 return;
             } else {
@@ -557,131 +1279,132 @@ private:
         if ((state.colors[u] == RED and state.colors[v] == RED) or
             (state.colors[u] == BLUE and state.colors[v] == BLUE)){
             {
-                SolutionState opt_skip = state;
+                SolutionState<V> opt_skip = state;
                 opt_skip.skipEdge();
-                #pragma omp task
-                {
-                    findBestStateDFS(opt_skip);
-                }
+                explore(opt_skip, depth);
             }
         } else if (state.colors[u] == NO_COLOR and state.colors[v] == NO_COLOR) {
             {
-                SolutionState opt_add_red_blue = state;
+                SolutionState<V> opt_add_red_blue = state;
                 opt_add_red_blue.addEdge();
                 opt_add_red_blue.colors[u] = RED;
                 opt_add_red_blue.colors[v] = BLUE;
-                #pragma omp task
-                {
-                    findBestStateDFS(opt_add_red_blue);
-                }
+                explore(opt_add_red_blue, depth);
             }
             {
-                SolutionState opt_add_blue_red = state;
+                SolutionState<V> opt_add_blue_red = state;
                 opt_add_blue_red.addEdge();
                 opt_add_blue_red.colors[u] = BLUE;
                 opt_add_blue_red.colors[v] = RED;
-                #pragma omp task
-                {
-                    findBestStateDFS(opt_add_blue_red);
-                }
+                explore(opt_add_blue_red, depth);
             }
             {
-                SolutionState opt_skip_red_red = state;
+                SolutionState<V> opt_skip_red_red = state;
                 opt_skip_red_red.skipEdge();
                 opt_skip_red_red.colors[u] = RED;
                 opt_skip_red_red.colors[v] = RED;
-                #pragma omp task
-                {
-                    findBestStateDFS(opt_skip_red_red);
-                }
+                explore(opt_skip_red_red, depth);
             }
             {
-                SolutionState opt_skip_blue_blue = state;
+                SolutionState<V> opt_skip_blue_blue = state;
                 opt_skip_blue_blue.skipEdge();
                 opt_skip_blue_blue.colors[u] = BLUE;
                 opt_skip_blue_blue.colors[v] = BLUE;
-                #pragma omp task
-                {
-                    findBestStateDFS(opt_skip_blue_blue);
-                }
+                explore(opt_skip_blue_blue, depth);
             }
         } else if ((state.colors[u] == RED and state.colors[v] == NO_COLOR) or
                    (state.colors[u] == BLUE and state.colors[v] == NO_COLOR)) {
             {
-                SolutionState opt_add_opposite = state;
+                SolutionState<V> opt_add_opposite = state;
                 opt_add_opposite.addEdge();
-                opt_add_opposite.colors[v] = SolutionState::getOppositeColor(opt_add_opposite.colors[u]);
-                #pragma omp task
-                {
-                    findBestStateDFS(opt_add_opposite);
-                }
+                opt_add_opposite.colors[v] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[u]);
+                explore(opt_add_opposite, depth);
             }
             {
-                SolutionState opt_skip_same = state;
+                SolutionState<V> opt_skip_same = state;
                 opt_skip_same.skipEdge();
                 opt_skip_same.colors[v] = opt_skip_same.colors[u];
-                #pragma omp task
-                {
-                    findBestStateDFS(opt_skip_same);
-                }
+                explore(opt_skip_same, depth);
             }
         } else if ((state.colors[u] == NO_COLOR and state.colors[v] == RED) or
                    (state.colors[u] == NO_COLOR and state.colors[v] == BLUE)) {
             {
-                SolutionState opt_add_opposite = state;
+                SolutionState<V> opt_add_opposite = state;
                 opt_add_opposite.addEdge();
-                opt_add_opposite.colors[u] = SolutionState::getOppositeColor(opt_add_opposite.colors[v]);
-                #pragma omp task
-                {
-                    findBestStateDFS(opt_add_opposite);
-                }
+                opt_add_opposite.colors[u] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[v]);
+                explore(opt_add_opposite, depth);
             }
             {
-                SolutionState opt_skip_same = state;
+                SolutionState<V> opt_skip_same = state;
                 opt_skip_same.skipEdge();
                 opt_skip_same.colors[u] = opt_skip_same.colors[v];
-                #pragma omp task
-                {
-                    findBestStateDFS(opt_skip_same);
-                }
+                explore(opt_skip_same, depth);
             }
         } else if ((state.colors[u] == RED and state.colors[v] == BLUE) or
                    (state.colors[u] == BLUE and state.colors[v] == RED)) {
             {
-                SolutionState opt_add = state;
+                SolutionState<V> opt_add = state;
                 opt_add.addEdge();
-                #pragma omp task
-                {
-                    findBestStateDFS(opt_add);
-                }
+                explore(opt_add, depth);
             }
         }
     }
 public:
-    void workerMain(){
-        // Receive graph
-        string graph_str;
-        MyMpi::recvString(MPI_MAIN, TAG_GRAPH, graph_str);
+    void solveInput(const string & graph_str) {
         graph.fromString(graph_str);
+        best_state = SolutionState<V>();
+        best_cost = 0;
+        thread_counters.assign(max(number_of_threads, 1), SearchCounters());
+        deadline = chrono::high_resolution_clock::now() + chrono::seconds(time_limit);
+        time_is_up = false;
         // Receive work
         while (true) {
             string initial_state_str;
-            MyMpi::recvString(MPI_MAIN, TAG_STATE, initial_state_str);
+            MPI_Status status = MyMpi::recvString(MPI_MAIN, MPI_ANY_TAG, initial_state_str);
             initial_state.fromString(initial_state_str, &graph);
-            if (all_of(initial_state.colors, initial_state.colors + MAX_VERTICES, [](color_t c){return c == NO_COLOR;})) {
+            if (status.MPI_TAG == TAG_BEST) {
+                // Incumbent shared by the main process, no reply expected
+                if (initial_state.isBetterThan(best_state)) {
+                    best_state = initial_state;
+                    best_cost = initial_state.cost;
+                }
+            } else if (all_of(initial_state.colors, initial_state.colors + V::max_vertices, [](color_t c){return c == NO_COLOR;})) {
                 break;
-            } else if (initial_state.isLeaf() and initial_state.isBetterThan(best_state)) {
-                best_state = initial_state;
             } else {
+                // Only the main thread communicates, the team just searches the subtree
                 #pragma omp parallel num_threads(number_of_threads)
                     #pragma omp single
-                        findBestStateDFS(initial_state);
+                        findBestStateDFS(initial_state, 0);
                 MyMpi::sendString(MPI_MAIN, TAG_BEST, best_state.toString());
+                SearchCounters subtree_counters;
+                for (auto & counters : thread_counters)
+                    subtree_counters += counters;
+                MyMpi::sendString(MPI_MAIN, TAG_COUNTERS, subtree_counters.toString());
+                thread_counters.assign(thread_counters.size(), SearchCounters());
             }
         }
     }
 };
 //----------------------------------------------------------------------------------------------------------------------
+// Every graph is searched by a worker of the smallest vertex count class it fits in
+void workerMain() {
+    int num_of_inputs;
+    MyMpi::recvInt(MPI_MAIN, TAG_NUM_OF_INPUTS, num_of_inputs);
+    for (int input = 0; input < num_of_inputs; input++) {
+        // Receive graph
+        string graph_str;
+        MyMpi::recvString(MPI_MAIN, TAG_GRAPH, graph_str);
+        int num_of_vertices = 0;
+        istringstream(graph_str) >> num_of_vertices;
+        if (num_of_vertices <= Vertices64::max_vertices)
+            make_unique<Worker<Vertices64>>()->solveInput(graph_str);
+        else if (num_of_vertices <= Vertices150::max_vertices)
+            make_unique<Worker<Vertices150>>()->solveInput(graph_str);
+        else
+            make_unique<Worker<Vertices1024>>()->solveInput(graph_str);
+    }
+}
+//----------------------------------------------------------------------------------------------------------------------
 class InputHandler {
 public:
     static void printHelp() {
@@ -691,42 +1414,156 @@ public:
         cout << "   -h, --help                  Výpíše tuto zprávu." << endl;
         cout << "   --file <filepath>...        Spustí program pro soubory." << endl;
         cout << "   --folder <folderpath>...    Spustí program pro složky." << endl;
+        cout << "   --checkpoint <file>         Průběžně ukládá stav prohledávání do souboru." << endl;
+        cout << "   --checkpoint-interval <s>   Interval ukládání v sekundách. Defaultní hodnota je 60." << endl;
+        cout << "   --resume <file>             Pokračuje ve výpočtu uloženém v souboru a dále do něj ukládá." << endl;
+        cout << "   --time-limit <s>            Časový limit v sekundách. Vypisuje každé zlepšení a skončí s nejlepším řešením." << endl;
+        cout << "   --progress <s>              Každých s sekund vypíše na chybový výstup uzly za sekundu, nejlepší cenu, podíl hotových" << endl;
+        cout << "                               stavů fronty a odhad zbývajícího času. Defaultně vypnuto." << endl;
+        cout << "   --progress-file <file>      Poslední zprávu o průběhu zapisuje do souboru místo chybového výstupu." << endl;
+        cout << "   --stats                     Vypíše počítadla prohledávání (uzly, listy, ořezání, zlepšení, úlohy) jako JSON." << endl;
+        cout << "   --output <json|csv>         Vypíše výsledek každého vstupu jako záznam na standardní výstup, text jde na chybový výstup." << endl;
+        cout << "   -t <num of threads>         Nastaví počet vláken v každém procesu. Defaultní hodnota je 1." << endl;
         cout << "Parametry jsou vyhodnocvány v pořadí." << endl;
         cout << "Jorge Zuňiga 2023" << endl;
     }
 
-    static vector<ProblemInstance> readFromFile(const string & input_file_path) {
-        vector<ProblemInstance> inputs;
-        cout << "Loaded file " << input_file_path << endl;
-        if (!fs::exists(fs::path(input_file_path))) {
-            cout << "File \"" << input_file_path << "\' does not exist." << endl;
-            return inputs;
+    // Reads the next integer, skips anything before it
+    static int scanInt(const char * & it, const char * end) {
+        while (it != end and (*it < '0' or *it > '9') and *it != '-')
+            it++;
+        bool negative = it != end and *it == '-';
+        if (negative)
+            it++;
+        int value = 0;
+        while (it != end and '0' <= *it and *it <= '9')
+            value = value * 10 + (*it++ - '0');
+        return negative ? -value : value;
+    }
+
+    // Skips the next number without converting it
+    static void skipInt(const char * & it, const char * end) {
+        while (it != end and *it <= ' ')
+            it++;
+        while (it != end and *it > ' ')
+            it++;
+    }
+
+    // Binary instance, the edges are already filtered and sorted, see converter/converter.cpp
+    static bool parseBinary(const char * it, const char * end, int & num_of_vertices, vector<InputEdge> & edges) {
+        // Vertices are stored as bytes, so binary instances always fit in Vertices150
+        using BinaryEdge = Edge<Vertices150>;
+        static_assert(sizeof(BinaryEdge) == 3, "Edges are stored as three bytes");
+        // The edge count is little endian whatever the host is
+        uint8_t n = uint8_t(it[4]);
+        uint16_t edges_size = uint16_t(uint8_t(it[5]) | uint8_t(it[6]) << 8);
+        const BinaryEdge * edges_begin = reinterpret_cast<const BinaryEdge *>(it + BINARY_HEADER_SIZE);
+        if (n > Vertices150::max_vertices or edges_size > Vertices150::max_edges or end - it < BINARY_HEADER_SIZE + edges_size * long(sizeof(BinaryEdge)))
+            return false;
+        num_of_vertices = n;
+        edges.reserve(edges_size);
+        for (const BinaryEdge * edge = edges_begin; edge != edges_begin + edges_size; edge++) {
+            // A malformed file would index past the vertices
+            if (edge->u >= n or edge->v >= n or edge->u == edge->v or edge->weight < MIN_WEIGHT or edge->weight > MAX_WEIGHT)
+                return false;
+            edges.emplace_back(edge->u, edge->v, edge->weight);
         }
-        ifstream input_file(input_file_path);
-        if (!input_file.is_open()) {
-            cout << "Error opening " << input_file_path << endl;
-            return inputs;
+        return true;
+    }
+
+    // The file is mapped into memory, only the upper triangle of the matrix is converted
+    static bool parseFile(const string & input_file_path, int & num_of_vertices, vector<InputEdge> & edges) {
+        int fd = open(input_file_path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) < 0 or file_stat.st_size == 0) {
+            close(fd);
+            return false;
         }
-        int num_of_vertices = 0;
-        vector<Edge> edges;
-        input_file >> num_of_vertices;
-        for (int row = 0; row < num_of_vertices; row ++) {
-            for (int column = 0; column < num_of_vertices; column++) {
-                int weight;
-                input_file >> weight;
-                if (column > row and MIN_WEIGHT <= weight and weight <= MAX_WEIGHT) {
-                    Edge edge(row, column, weight);
-                    edges.push_back(edge);
+        size_t size = file_stat.st_size;
+        void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        const char * it = static_cast<const char *>(data);
+        const char * end = it + size;
+        bool parsed = true;
+        if (size >= BINARY_HEADER_SIZE and memcmp(it, BINARY_MAGIC, 4) == 0) {
+            parsed = parseBinary(it, end, num_of_vertices, edges);
+        } else {
+            num_of_vertices = scanInt(it, end);
+            // Too large inputs are reported by the caller
+            if (num_of_vertices > Vertices1024::max_vertices)
+                num_of_vertices = -num_of_vertices;
+            edges.reserve(max(num_of_vertices, 0) * max(num_of_vertices - 1, 0) / 2);
+            for (int row = 0; row < num_of_vertices; row++) {
+                for (int column = 0; column <= row; column++)
+                    skipInt(it, end);
+                for (int column = row + 1; column < num_of_vertices; column++) {
+                    int weight = scanInt(it, end);
+                    if (MIN_WEIGHT <= weight and weight <= MAX_WEIGHT)
+                        edges.emplace_back(row, column, weight);
                 }
             }
         }
-        input_file.close();
-        inputs.emplace_back(input_file_path, num_of_vertices, edges);
+        munmap(data, size);
+        return parsed;
+    }
+
+    // Every input is solved with the smallest vertex count class it fits in
+    static unique_ptr<Instance> makeInstance(const string & input_file_path, int num_of_vertices, const vector<InputEdge> & edges) {
+        if (num_of_vertices <= Vertices64::max_vertices)
+            return make_unique<ProblemInstance<Vertices64>>(input_file_path, num_of_vertices, edges);
+        if (num_of_vertices <= Vertices150::max_vertices)
+            return make_unique<ProblemInstance<Vertices150>>(input_file_path, num_of_vertices, edges);
+        return make_unique<ProblemInstance<Vertices1024>>(input_file_path, num_of_vertices, edges);
+    }
+
+    static vector<unique_ptr<Instance>> readFromFiles(const vector<string> & input_file_paths) {
+        vector<int> nums_of_vertices(input_file_paths.size(), 0);
+        vector<vector<InputEdge>> edges(input_file_paths.size());
+        vector<char> parsed(input_file_paths.size(), false);
+        #pragma omp parallel for schedule(dynamic) num_threads(number_of_threads)
+        for (size_t i = 0; i < input_file_paths.size(); i++)
+            parsed[i] = parseFile(input_file_paths[i], nums_of_vertices[i], edges[i]);
+        vector<unique_ptr<Instance>> inputs;
+        for (size_t i = 0; i < input_file_paths.size(); i++) {
+            cout << "Loaded file " << input_file_paths[i] << endl;
+            if (!fs::exists(fs::path(input_file_paths[i])))
+                cout << "File \"" << input_file_paths[i] << "\' does not exist." << endl;
+            else if (!parsed[i])
+                cout << "Error opening " << input_file_paths[i] << endl;
+            else if (nums_of_vertices[i] < 0)
+                cout << "Too many vertices in " << input_file_paths[i] << ", at most " << Vertices1024::max_vertices << " are supported." << endl;
+            else
+                inputs.push_back(makeInstance(input_file_paths[i], nums_of_vertices[i], edges[i]));
+        }
         return inputs;
     }
 
-    static vector<ProblemInstance> readInput(int argc, char* argv[]) {
-        vector<ProblemInstance> inputs;
+    static vector<unique_ptr<Instance>> readFromFile(const string & input_file_path) {
+        return readFromFiles({input_file_path});
+    }
+
+    static void readOptions(int argc, char* argv[]) {
+        vector<string> args(argv + 1, argv+argc);
+        // If -t <int> is found, set the number of threads variable. Read by every rank.
+        auto thread_num_arg_it = find(args.begin(), args.end(), "-t");
+        if (thread_num_arg_it != args.end() and next(thread_num_arg_it) != args.end()) {
+            istringstream iss(*next(thread_num_arg_it));
+            iss >> number_of_threads;
+        }
+        // If --time-limit <s> is found, every rank stops searching at the deadline
+        auto time_limit_arg_it = find(args.begin(), args.end(), "--time-limit");
+        if (time_limit_arg_it != args.end() and next(time_limit_arg_it) != args.end()) {
+            istringstream iss(*next(time_limit_arg_it));
+            iss >> time_limit;
+        }
+    }
+
+    static vector<unique_ptr<Instance>> readInput(int argc, char* argv[]) {
+        vector<unique_ptr<Instance>> inputs;
         vector<string> args(argv + 1, argv+argc);
         // Find flags -h, --help, --file <filepath>...
         bool help_arg_found_short = find(args.begin(), args.end(), "-h") != args.end();
@@ -741,47 +1578,97 @@ public:
             InputHandler::printHelp();
             return inputs;
         }
-        // If -t <int> is found, set the number of threads variable
-        if (thread_num_arg_found) {
-            auto num_of_threads_it = next(thread_num_arg_it);
-            if (num_of_threads_it != args.end()) {
-                istringstream iss(*num_of_threads_it);
-                iss >> number_of_threads;
+        // If --output json|csv is found, print a record per instance and move the text to the standard error
+        auto output_arg_it = find(args.begin(), args.end(), "--output");
+        if (output_arg_it != args.end() and next(output_arg_it) != args.end()) {
+            output_format = *next(output_arg_it);
+            if (output_format == "json" or output_format == "csv") {
+                cout.rdbuf(cerr.rdbuf());
+            } else {
+                cout << "Unknown output format " << output_format << endl;
+                output_format = "text";
             }
-            cout << "Number of threads: " << number_of_threads << endl;
         }
+        // If --checkpoint <file> or --resume <file> is found, checkpoint the search into the file
+        auto checkpoint_arg_it = find(args.begin(), args.end(), "--checkpoint");
+        if (checkpoint_arg_it != args.end() and next(checkpoint_arg_it) != args.end())
+            checkpoint_path = *next(checkpoint_arg_it);
+        auto resume_arg_it = find(args.begin(), args.end(), "--resume");
+        if (resume_arg_it != args.end() and next(resume_arg_it) != args.end()) {
+            checkpoint_path = *next(resume_arg_it);
+            resume = true;
+        }
+        auto checkpoint_interval_arg_it = find(args.begin(), args.end(), "--checkpoint-interval");
+        if (checkpoint_interval_arg_it != args.end() and next(checkpoint_interval_arg_it) != args.end()) {
+            istringstream iss(*next(checkpoint_interval_arg_it));
+            iss >> checkpoint_interval;
+        }
+        // If --progress <s> is found, report the progress of the search every s seconds
+        auto progress_arg_it = find(args.begin(), args.end(), "--progress");
+        if (progress_arg_it != args.end() and next(progress_arg_it) != args.end()) {
+            istringstream iss(*next(progress_arg_it));
+            iss >> progress_interval;
+        }
+        // If --progress-file <file> is found, keep the last progress report in the file instead of the standard error
+        auto progress_file_arg_it = find(args.begin(), args.end(), "--progress-file");
+        if (progress_file_arg_it != args.end() and next(progress_file_arg_it) != args.end())
+            progress_path = *next(progress_file_arg_it);
+        // If --stats is found, print the search counters of every instance as JSON
+        if (find(args.begin(), args.end(), "--stats") != args.end())
+            print_stats = true;
+        // Number of threads is already set by readOptions
+        if (thread_num_arg_found)
+            cout << "Number of threads: " << number_of_threads << endl;
         // If --file <filepath>... is present, extract from files
         if (file_arg_found) {
             auto input_files_it = next(file_arg_it);
-            while (input_files_it != args.end() and *input_files_it != "--folder") {
-                vector<ProblemInstance> file_input = InputHandler::readFromFile(*input_files_it);
-                inputs.insert(inputs.end(), file_input.begin(), file_input.end());
+            vector<string> input_file_paths;
+            while (input_files_it != args.end() and !input_files_it->empty() and input_files_it->front() != '-') {
+                input_file_paths.push_back(*input_files_it);
                 input_files_it = next(input_files_it);
             }
+            vector<unique_ptr<Instance>> file_inputs = InputHandler::readFromFiles(input_file_paths);
+            inputs.insert(inputs.end(), make_move_iterator(file_inputs.begin()), make_move_iterator(file_inputs.end()));
         }
         return inputs;
     }
 };
 //----------------------------------------------------------------------------------------------------------------------
 int main(int argc, char* argv[]) {
-    MPI_Init(&argc, &argv);
-    int rank;
+    // Only the main thread of each process calls MPI, OpenMP threads just search
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    int rank, world_size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+    InputHandler::readOptions(argc, argv);
+    if (provided < MPI_THREAD_FUNNELED) {
+        if (rank == MPI_MAIN)
+            cout << "MPI does not support threads, running with 1 thread per process." << endl;
+        number_of_threads = 1;
+    }
     // Main process
     if (rank == MPI_MAIN) {
         // Read input
-        vector<ProblemInstance> inputs = InputHandler::readInput(argc, argv);
+        auto start_time_load = chrono::high_resolution_clock::now();
+        vector<unique_ptr<Instance>> inputs = InputHandler::readInput(argc, argv);
+        auto end_time_load = chrono::high_resolution_clock::now();
+        // Tell the workers how many graphs to expect
+        for (int i = 1; i < world_size; i++)
+            MyMpi::sendInt(i, TAG_NUM_OF_INPUTS, int(inputs.size()));
         // Measure time
         auto start_time_total = chrono::high_resolution_clock::now();
         // Find solutions
         for (auto & problem_instance : inputs)
-            problem_instance.findMaxConnectedBipartiteSubgraph();
+            problem_instance->findMaxConnectedBipartiteSubgraph();
         // End of time measure
         auto end_time_total = chrono::high_resolution_clock::now();
-        // Print total time if more than one result
-        if (inputs.size() > 1) {
+        // Print load time, total time if more than one result
+        if (!inputs.empty()) {
             cout << "============================================" << endl;
-            cout << "Total time: " << Format::elapsedTime(start_time_total, end_time_total) << endl;
+            cout << "Load time: " << Format::elapsedTime(start_time_load, end_time_load) << endl;
+            if (inputs.size() > 1)
+                cout << "Total time: " << Format::elapsedTime(start_time_total, end_time_total) << endl;
             cout << "============================================" << endl;
         }
         // Assert
@@ -822,20 +1709,20 @@ int main(int argc, char* argv[]) {
                 {"graf_30_25.txt", 21336}
         };
         // Print if wrong result
-        for (auto problem_instance : inputs) {
-            string name = fs::path(problem_instance.getInputName()).filename();
+        for (auto & problem_instance : inputs) {
+            // Binary inputs share the name of the text input
+            string name = fs::path(problem_instance->getInputName()).stem().string() + ".txt";
             if (results.count(name) > 0) {
                 uint32_t expected = results[name];
-                uint32_t got = problem_instance.getBestStateCost();
+                uint32_t got = problem_instance->getBestStateCost();
                 if (got != expected)
-                    cout << problem_instance.getInputName() << " expected: " << expected << " got: " << got << endl;
+                    cout << problem_instance->getInputName() << " expected: " << expected << " got: " << got << endl;
             }
         }
     }
     // Worker process
     if (rank != MPI_MAIN) {
-        Worker worker;
-        worker.workerMain();
+        workerMain();
     }
     MPI_Finalize();
     return 0;
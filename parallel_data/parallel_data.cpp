@@ -6,22 +6,43 @@
 #include <iostream>
 #include <utility>
 #include <vector>
+#include <memory>
 #include <string>
 #include <filesystem>
 #include <chrono>
+#include <iomanip>
 #include <algorithm>
 #include <fstream>
 #include <unordered_map>
 #include <queue>
+#include <set>
+#include <random>
 #include <cstdint>
 #include <cstring>
 #include <thread>
+#include <atomic>
+#include <functional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <omp.h>
 
-#define MAX_VERTICES 150
-#define MAX_EDGES 11175 // 150 choose 2
 #define MAX_WEIGHT 120
 #define MIN_WEIGHT 80
+#define BINARY_MAGIC "PDPG" // Instances made by the converter
+#define BINARY_HEADER_SIZE 11
+// Number of open states the search is split into when checkpointing, at most this many otherwise
+#define FRONTIER_SIZE 1024
+#define ESTIMATE_PROBES 32 // Random probes of the size of a work unit
+#define UNITS_PER_WORKER 8 // Work units of about the same estimated size per worker
+// Largest graph enumerated by the Gray code engine, one bit per vertex in uint32_t
+#define GRAY_MAX_VERTICES 32
+// Largest graph the auto engine enumerates, bigger ones are searched by the edges
+#define GRAY_AUTO_VERTICES 20
+// Memory of the dynamic programming tables of one graph, a cell takes about 5 bytes. The search has no forced moves,
+// so the tables are faster than the search up to this size.
+#define DP_MAX_MIB 1024
 
 // Default number of threads
 int number_of_threads = 1;
@@ -30,11 +51,61 @@ using namespace std;
 namespace fs = std::filesystem;
 using time_point = chrono::high_resolution_clock::time_point;
 
+// Checkpointing
+string checkpoint_path;
+int checkpoint_interval = 60; // seconds
+bool resume = false;
+
+// Anytime mode
+int time_limit = 0; // seconds, 0 = no limit
+time_point deadline;
+atomic<bool> time_is_up{false};
+
+// Preprocessing
+bool preprocess = true; // Split the graph into biconnected blocks
+int max_dp_width = 22; // Largest tree decomposition width solved by dynamic programming, 0 = off
+
+// Engine, gray enumerates all colorings, edge decides one edge per level, auto enumerates the small graphs only
+string engine = "auto";
+
+// Statistics
+bool print_stats = false; // Print the search counters as JSON
+int progress_interval = 0; // Seconds between the progress reports, 0 = off
+string progress_path; // Status file with the last progress report, standard error if empty
+
+// Machine readable output, the records go to the standard output and the text to the standard error
+string output_format = "text"; // text, json or csv
+ostream record_output(cout.rdbuf());
+
 enum color_t : uint8_t {NO_COLOR, RED, BLUE};
 
-class Edge;
-class SolutionState;
-class ProblemInstance;
+// Vertex count classes, every input is solved with the smallest one it fits in
+struct Vertices64 {
+    static constexpr int max_vertices = 64;
+    static constexpr int max_edges = 2016; // 64 choose 2
+    using vertex_t = uint8_t;
+    using edge_index_t = uint16_t;
+};
+
+struct Vertices150 {
+    static constexpr int max_vertices = 150;
+    static constexpr int max_edges = 11175; // 150 choose 2
+    using vertex_t = uint8_t;
+    using edge_index_t = uint16_t;
+};
+
+struct Vertices1024 {
+    static constexpr int max_vertices = 1024;
+    static constexpr int max_edges = 523776; // 1024 choose 2
+    using vertex_t = uint16_t;
+    using edge_index_t = int32_t;
+};
+
+template <typename V> class Edge;
+template <typename V> class SolutionState;
+template <typename V> class Checkpoint;
+class Instance;
+template <typename V> class ProblemInstance;
 class InputHandler;
 
 string prettyPrintElapsedTime(time_point start_time, time_point end_time) {
@@ -46,7 +117,7 @@ string prettyPrintElapsedTime(time_point start_time, time_point end_time) {
     auto s = chrono::duration_cast<chrono::seconds>(ms);
     ms -= chrono::duration_cast<chrono::milliseconds>(s);
     ostringstream oss;
-    oss << h.count() << "h:" << m.count() << "m:" << s.count() << "." << ms.count() << "s";
+    oss << h.count() << "h:" << m.count() << "m:" << s.count() << "." << setw(3) << setfill('0') << ms.count() << "s";
     return oss.str();
 }
 
@@ -66,10 +137,226 @@ string formatWithCommas(uint64_t number) {
     return formatted;
 }
 
+// Result of one instance for --output json or csv
+struct ResultRecord {
+    string backend;
+    string input;
+    int vertices = 0;
+    int edges = 0;
+    uint32_t cost = 0;
+    vector<int> red;
+    vector<int> blue;
+    int64_t elapsed_us = 0;
+    uint64_t nodes = 0;
+    int threads = 1;
+    int ranks = 1;
+
+    static string joined(const vector<int> & vertices, const string & separator) {
+        ostringstream oss;
+        for (size_t i = 0; i < vertices.size(); i++)
+            oss << (i > 0 ? separator : "") << vertices[i];
+        return oss.str();
+    }
+
+    static string quoted(const string & text) {
+        string escaped = "\"";
+        for (char c : text) {
+            if (c == '"' or c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped + "\"";
+    }
+
+    void print(ostream & out) const {
+        if (output_format == "json") {
+            out << "{\"backend\": " << quoted(backend) << ", \"input\": " << quoted(input)
+                << ", \"vertices\": " << vertices << ", \"edges\": " << edges << ", \"cost\": " << cost
+                << ", \"red\": [" << joined(red, ", ") << "], \"blue\": [" << joined(blue, ", ") << "]"
+                << ", \"elapsed_us\": " << elapsed_us << ", \"nodes\": " << nodes
+                << ", \"threads\": " << threads << ", \"ranks\": " << ranks << "}" << endl;
+        } else if (output_format == "csv") {
+            static bool header_printed = false;
+            if (!header_printed) {
+                out << "backend,input,vertices,edges,cost,red,blue,elapsed_us,nodes,threads,ranks" << endl;
+                header_printed = true;
+            }
+            // CSV quotes are doubled, not escaped
+            string input_field = input;
+            for (size_t i = 0; (i = input_field.find('"', i)) != string::npos; i += 2)
+                input_field.insert(i, 1, '"');
+            out << backend << ",\"" << input_field << "\"," << vertices << "," << edges << "," << cost << ","
+                << joined(red, " ") << "," << joined(blue, " ") << "," << elapsed_us << "," << nodes << ","
+                << threads << "," << ranks << endl;
+        }
+    }
+};
+
+bool timeIsUp() {
+    static thread_local uint32_t calls = 0;
+    // Reading the clock on every call would slow down the search
+    if (time_limit > 0 and !time_is_up.load(memory_order_relaxed) and (++calls & 1023) == 0)
+        time_is_up = chrono::high_resolution_clock::now() >= deadline;
+    return time_is_up.load(memory_order_relaxed);
+}
+
+// Progress of the running search, read by the progress reporter from its own thread. The searches publish their nodes
+// in batches and their improvements with relaxed atomic stores, the reporter never reads the fields they work on.
+struct SearchProgress {
+    static constexpr uint64_t NODES_BATCH = 1024;
+    atomic<uint64_t> nodes{0};
+    atomic<uint32_t> best_cost{0};
+    atomic<bool> costs_of_graph{true}; // False while a part of the graph is searched, its costs are not the graph's
+
+    void reset() {
+        nodes.store(0, memory_order_relaxed);
+        best_cost.store(0, memory_order_relaxed);
+        costs_of_graph.store(true, memory_order_relaxed);
+    }
+
+    // Keeps the largest cost, the threads may publish their costs out of order
+    void improve(uint32_t cost) {
+        uint32_t best = best_cost.load(memory_order_relaxed);
+        while (costs_of_graph.load(memory_order_relaxed) and cost > best
+               and !best_cost.compare_exchange_weak(best, cost, memory_order_relaxed)) {
+        }
+    }
+
+    // Hides the costs of a part of the graph until restore, returns the previous state for it
+    bool hideCosts() {
+        return costs_of_graph.exchange(false, memory_order_relaxed);
+    }
+
+    void restore(bool previous) {
+        costs_of_graph.store(previous, memory_order_relaxed);
+    }
+};
+SearchProgress search_progress;
+
+// Search counters of one thread. Every thread counts into its own cache line, so the threads do not slow each
+// other down, and the counters are summed after the search.
+struct alignas(64) SearchCounters {
+    uint64_t nodes = 0;
+    uint64_t leaves = 0;
+    uint64_t weight_prunes = 0;     // The remaining weight cannot beat the best cost
+    uint64_t edge_count_prunes = 0; // Too few remaining edges to connect all vertices
+    uint64_t improvements = 0;
+    uint64_t tasks = 0;
+
+    SearchCounters & operator += (const SearchCounters & other) {
+        nodes += other.nodes;
+        leaves += other.leaves;
+        weight_prunes += other.weight_prunes;
+        edge_count_prunes += other.edge_count_prunes;
+        improvements += other.improvements;
+        tasks += other.tasks;
+        return *this;
+    }
+
+    // Counts a node, every NODES_BATCH nodes of the counters are published to the progress reporter
+    void countNode() {
+        if (++nodes % SearchProgress::NODES_BATCH == 0)
+            search_progress.nodes.fetch_add(SearchProgress::NODES_BATCH, memory_order_relaxed);
+    }
+
+    void countImprovement(uint32_t cost) {
+        improvements++;
+        search_progress.improve(cost);
+    }
+
+    void printJson(double seconds, int threads) const {
+        cout << "{\"nodes\": " << nodes
+             << ", \"nodes_per_second\": " << uint64_t(seconds > 0 ? double(nodes) / seconds : 0.0)
+             << ", \"leaves\": " << leaves
+             << ", \"weight_prunes\": " << weight_prunes
+             << ", \"edge_count_prunes\": " << edge_count_prunes
+             << ", \"improvements\": " << improvements
+             << ", \"tasks\": " << tasks
+             << ", \"threads\": " << threads << "}" << endl;
+    }
+};
+
+// Numbers of a running search read by the progress reporter
+struct ProgressSample {
+    uint64_t nodes = 0;
+    uint32_t best_cost = 0;
+    size_t units_done = 0;  // Finished states of the frontier
+    size_t units_total = 0; // 0 if the search has no frontier
+};
+
+// Writes the progress of a running search every progress_interval seconds from its own thread. The search never
+// waits for it, the reports are read from search_progress, so a report is a snapshot that may be a moment old.
+class ProgressReporter {
+private:
+    string input_name;
+    function<ProgressSample()> sample;
+    time_point start_time;
+    atomic<bool> stopping{false};
+    thread reporter;
+
+    void report(uint64_t & last_nodes, time_point & last_time) {
+        ProgressSample progress = sample();
+        auto now = chrono::high_resolution_clock::now();
+        double interval = chrono::duration<double>(now - last_time).count();
+        uint64_t new_nodes = progress.nodes > last_nodes ? progress.nodes - last_nodes : 0;
+        last_nodes = progress.nodes;
+        last_time = now;
+        ostringstream oss;
+        oss << "Progress of " << input_name << ": " << prettyPrintElapsedTime(start_time, now)
+            << ", nodes " << formatWithCommas(progress.nodes)
+            << " (" << formatWithCommas(interval > 0 ? uint64_t(double(new_nodes) / interval) : 0) << "/s)"
+            << ", best " << progress.best_cost;
+        // The units of the frontier are about the same size, the rest takes as long per unit as the done ones
+        if (progress.units_total > 0) {
+            double done = double(progress.units_done) / double(progress.units_total);
+            oss << ", frontier " << progress.units_done << "/" << progress.units_total
+                << " (" << fixed << setprecision(1) << 100.0 * done << " %)";
+            if (progress.units_done > 0) {
+                auto remaining = chrono::duration<double>(now - start_time) * ((1.0 - done) / done);
+                oss << ", ETA " << prettyPrintElapsedTime(now, now + chrono::duration_cast<time_point::duration>(remaining));
+            }
+        }
+        if (progress_path.empty()) {
+            cerr << oss.str() << endl;
+            return;
+        }
+        // The status file always holds a whole report
+        string temporary_path = progress_path + ".tmp";
+        {
+            ofstream status_file(temporary_path, ios::trunc);
+            status_file << oss.str() << endl;
+        }
+        error_code error;
+        fs::rename(temporary_path, progress_path, error);
+    }
+public:
+    ProgressReporter(const string & input_name, function<ProgressSample()> sample)
+        : input_name(input_name), sample(move(sample)), start_time(chrono::high_resolution_clock::now()) {
+        reporter = thread([this] {
+            uint64_t last_nodes = 0;
+            time_point last_time = start_time;
+            time_point next_report = start_time + chrono::seconds(progress_interval);
+            while (!stopping.load()) {
+                this_thread::sleep_for(chrono::milliseconds(100));
+                if (chrono::high_resolution_clock::now() < next_report)
+                    continue;
+                report(last_nodes, last_time);
+                next_report += chrono::seconds(progress_interval);
+            }
+        });
+    }
+
+    ~ProgressReporter() {
+        stopping = true;
+        reporter.join();
+    }
+};
+
+template <typename V>
 class Edge {
 public:
-    uint8_t u; // < 150
-    uint8_t v; // < 150
+    typename V::vertex_t u;
+    typename V::vertex_t v;
     uint8_t weight; // 80 <= weight <= 120
 public:
     Edge() {
@@ -100,16 +387,20 @@ public:
     }
 };
 
+// Edges as read from the input, before the instance size is known
+using InputEdge = Edge<Vertices1024>;
+
+template <typename V>
 class SolutionState {
 public:
-    color_t colors[MAX_VERTICES] = {NO_COLOR};
-    uint8_t num_of_vertices = 0; // < 150
-    uint16_t edge_index = 0; // < 11175 = (150 choose 2)
-    uint16_t used_edges = 0; // < 11175 = (150 choose 2)
+    color_t colors[V::max_vertices] = {NO_COLOR};
+    typename V::vertex_t num_of_vertices = 0;
+    typename V::edge_index_t edge_index = 0;
+    typename V::edge_index_t used_edges = 0;
     uint32_t cost = 0; // < 1341000 = 11175 * 120
     uint32_t sum_cost_all = 0; // < 1341000 = 11175 * 120
-    Edge * edges = nullptr;
-    uint16_t edges_size = 0; // < 11175 = (150 choose 2)
+    Edge<V> * edges = nullptr;
+    typename V::edge_index_t edges_size = 0;
     uint32_t edges_total_weight = 0; // < 1341000 = 11175 * 120
 public:
     void resetSolution() {
@@ -157,28 +448,29 @@ public:
         return true;
     }
 
-    void isConnectedDFS(const uint8_t (& adj_map)[MAX_VERTICES][MAX_VERTICES], const uint8_t (& adj_map_sizes)[MAX_VERTICES], uint8_t v, bool (& visited)[MAX_VERTICES]) {
-        visited[v] = true;
-        for (int i = 0; i < adj_map_sizes[v]; i++)
-            if (!visited[adj_map[v][i]])
-                isConnectedDFS(adj_map, adj_map_sizes, adj_map[v][i], visited);
+    // Union-find with path halving, an adjacency matrix would not fit on the stack for larger graphs
+    static int findRoot(typename V::vertex_t (& parent)[V::max_vertices], int v) {
+        while (parent[v] != v) {
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
     }
 
     bool isConnected() {
-        uint8_t adj_map[MAX_VERTICES][MAX_VERTICES] = {{0}};
-        uint8_t adj_map_sizes[MAX_VERTICES] = {0};
+        typename V::vertex_t parent[V::max_vertices];
+        for (int i = 0; i < num_of_vertices; i++)
+            parent[i] = i;
+        int components = num_of_vertices;
         for (int i = 0; i < edges_size; i++) {
-            adj_map[edges[i].u][adj_map_sizes[edges[i].u]] = edges[i].v;
-            adj_map_sizes[edges[i].u]++;
-            adj_map[edges[i].v][adj_map_sizes[edges[i].v]] = edges[i].u;
-            adj_map_sizes[edges[i].v]++;
-        }
-        bool visited[MAX_VERTICES] = {false};
-        isConnectedDFS(adj_map, adj_map_sizes, 0, visited);
-        for (int i = 0; i < num_of_vertices; ++i)
-            if (!visited[i])
-                return false;
-        return true;
+            int root_u = findRoot(parent, edges[i].u);
+            int root_v = findRoot(parent, edges[i].v);
+            if (root_u != root_v) {
+                parent[root_u] = root_v;
+                components--;
+            }
+        }
+        return components <= 1;
     }
 
     uint32_t sumWeightRemainingEdges() const {
@@ -210,14 +502,238 @@ public:
     }
 };
 
-class ProblemInstance {
+template <typename V>
+class Checkpoint {
+    // Binary layout (native byte order):
+    //   "PDPC", name length (u16), input name, num_of_vertices (u16), edges_size (u32),
+    //   best state, number of frontier states (u32), frontier states.
+    // A state is edge_index (u32), used_edges (u32), cost (u32), sum_cost_all (u32)
+    // and the colors packed 4 per byte.
+private:
+    template<typename T>
+    static void write(ofstream & out, T value) {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    static T read(ifstream & in) {
+        T value{};
+        in.read(reinterpret_cast<char *>(&value), sizeof(value));
+        return value;
+    }
+
+    static void writeState(ofstream & out, const SolutionState<V> & state) {
+        write(out, uint32_t(state.edge_index));
+        write(out, uint32_t(state.used_edges));
+        write(out, state.cost);
+        write(out, state.sum_cost_all);
+        for (int i = 0; i < state.num_of_vertices; i += 4) {
+            uint8_t packed = 0;
+            for (int j = 0; j < 4 and i + j < state.num_of_vertices; j++)
+                packed |= state.colors[i + j] << (2 * j);
+            write(out, packed);
+        }
+    }
+
+    // False if the state cannot belong to the instance, the file is corrupt
+    static bool readState(ifstream & in, SolutionState<V> & state, uint32_t edges_size) {
+        uint32_t edge_index = read<uint32_t>(in);
+        uint32_t used_edges = read<uint32_t>(in);
+        if (edge_index > edges_size or used_edges > edge_index)
+            return false;
+        state.edge_index = edge_index;
+        state.used_edges = used_edges;
+        state.cost = read<uint32_t>(in);
+        state.sum_cost_all = read<uint32_t>(in);
+        for (int i = 0; i < state.num_of_vertices; i += 4) {
+            auto packed = read<uint8_t>(in);
+            for (int j = 0; j < 4 and i + j < state.num_of_vertices; j++) {
+                state.colors[i + j] = color_t((packed >> (2 * j)) & 3);
+                if (state.colors[i + j] > BLUE)
+                    return false;
+            }
+        }
+        return bool(in);
+    }
+public:
+    static void save(const string & path, const string & input_name, const SolutionState<V> & best_state, const vector<SolutionState<V>> & frontier) {
+        string tmp_path = path + ".tmp";
+        ofstream out(tmp_path, ios::binary | ios::trunc);
+        if (!out.is_open()) {
+            cout << "Error writing checkpoint " << path << endl;
+            return;
+        }
+        string name = fs::path(input_name).filename();
+        out.write("PDPC", 4);
+        write(out, uint16_t(name.size()));
+        out.write(name.data(), streamsize(name.size()));
+        write(out, uint16_t(best_state.num_of_vertices));
+        write(out, uint32_t(best_state.edges_size));
+        writeState(out, best_state);
+        write(out, uint32_t(frontier.size()));
+        for (const auto & state : frontier)
+            writeState(out, state);
+        out.close();
+        // Replace the previous checkpoint only once the new one is complete
+        fs::rename(tmp_path, path);
+    }
+
+    // States are read on top of initial_state, so they share its graph. Nothing is changed unless the whole file is valid.
+    static bool load(const string & path, const string & input_name, const SolutionState<V> & initial_state, SolutionState<V> & best_state, vector<SolutionState<V>> & frontier) {
+        ifstream in(path, ios::binary);
+        if (!in.is_open())
+            return false;
+        char magic[4];
+        in.read(magic, 4);
+        if (!in or memcmp(magic, "PDPC", 4) != 0)
+            return false;
+        string name(read<uint16_t>(in), '\0');
+        in.read(&name[0], streamsize(name.size()));
+        if (name != string(fs::path(input_name).filename()))
+            return false;
+        uint16_t num_of_vertices = read<uint16_t>(in);
+        uint32_t edges_size = read<uint32_t>(in);
+        if (num_of_vertices != initial_state.num_of_vertices or edges_size != uint32_t(initial_state.edges_size))
+            return false;
+        SolutionState<V> loaded_best_state = initial_state;
+        if (!readState(in, loaded_best_state, edges_size))
+            return false;
+        // The number of states has to match the rest of the file, so a truncated file is not read past its end
+        uint32_t frontier_size = read<uint32_t>(in);
+        streamoff state_bytes = streamoff(4 * sizeof(uint32_t) + (num_of_vertices + 3) / 4);
+        streamoff position = in.tellg();
+        in.seekg(0, ios::end);
+        streamoff remaining = in.tellg() - position;
+        in.seekg(position);
+        if (!in or remaining != streamoff(frontier_size) * state_bytes)
+            return false;
+        vector<SolutionState<V>> loaded_frontier(frontier_size, initial_state);
+        for (auto & state : loaded_frontier)
+            if (!readState(in, state, edges_size))
+                return false;
+        best_state = loaded_best_state;
+        frontier = std::move(loaded_frontier);
+        return true;
+    }
+};
+
+// Exhaustive search of all colorings in Gray code order. Consecutive colorings differ in one vertex, so the cost is
+// updated by the edges of that vertex only and the connectivity of the cut is checked only when the cost beats the
+// best one. Vertex i is blue if bit i of the coloring is set, the last vertex stays red, swapping the colors gives the
+// same cut. The colorings are split by their highest bits into prefixes, each prefix is enumerated on its own.
+template <typename V>
+class GraySearch {
+public:
+    struct Result {
+        uint32_t colors = 0;
+        uint32_t cost = 0;
+        SearchCounters counters;
+    };
 private:
-    Edge edges[MAX_EDGES];
-    uint16_t edges_size;
-    SolutionState initial_state;
-    SolutionState best_state;
+    int num_of_vertices;
+    uint32_t all_vertices;
+    uint32_t neighbours[GRAY_MAX_VERTICES] = {0};
+    vector<pair<int, uint32_t>> adjacency[GRAY_MAX_VERTICES];
+private:
+    uint32_t cutCost(uint32_t colors) const {
+        uint32_t cost = 0;
+        for (int v = 0; v < num_of_vertices; v++)
+            for (auto [w, weight] : adjacency[v])
+                if (v < w and ((colors >> v) ^ (colors >> w)) & 1)
+                    cost += weight;
+        return cost;
+    }
+
+    // Breadth-first search over the edges between the color classes, the frontier is a bit set
+    bool isCutConnected(uint32_t colors) const {
+        uint32_t reached = 1;
+        uint32_t frontier = 1;
+        while (frontier != 0) {
+            int v = __builtin_ctz(frontier);
+            frontier &= frontier - 1;
+            uint32_t other_color = (colors >> v) & 1 ? ~colors : colors;
+            uint32_t next = neighbours[v] & other_color & ~reached;
+            reached |= next;
+            frontier |= next;
+        }
+        return reached == all_vertices;
+    }
+public:
+    explicit GraySearch(const SolutionState<V> & initial_state) : num_of_vertices(initial_state.num_of_vertices) {
+        all_vertices = num_of_vertices == 32 ? ~0u : (1u << num_of_vertices) - 1;
+        for (int i = 0; i < initial_state.edges_size; i++) {
+            const Edge<V> & edge = initial_state.edges[i];
+            neighbours[edge.u] |= 1u << edge.v;
+            neighbours[edge.v] |= 1u << edge.u;
+            adjacency[edge.u].emplace_back(edge.v, edge.weight);
+            adjacency[edge.v].emplace_back(edge.u, edge.weight);
+        }
+    }
+
+    // Enumerates the colorings whose vertices from n - 1 - prefix_bits to n - 2 have the bits of the prefix,
+    // only a coloring better than best_cost is returned
+    Result searchPrefix(uint32_t prefix, int prefix_bits, uint32_t best_cost) const {
+        Result result;
+        result.cost = best_cost;
+        int free_bits = num_of_vertices - 1 - prefix_bits;
+        uint32_t colors = prefix << free_bits;
+        uint32_t cost = cutCost(colors);
+        for (uint64_t i = 0; i < uint64_t(1) << free_bits; i++) {
+            if (i > 0) {
+                int v = __builtin_ctzll(i);
+                uint32_t color_v = (colors >> v) & 1;
+                for (auto [w, weight] : adjacency[v]) {
+                    if (((colors >> w) & 1) == color_v)
+                        cost += weight;
+                    else
+                        cost -= weight;
+                }
+                colors ^= 1u << v;
+            }
+            result.counters.countNode();
+            if (cost > result.cost) {
+                result.counters.leaves++;
+                if (isCutConnected(colors)) {
+                    result.colors = colors;
+                    result.cost = cost;
+                    result.counters.countImprovement(cost);
+                }
+            }
+        }
+        return result;
+    }
+};
+
+// Interface of the instances of all sizes
+class Instance {
+public:
+    virtual ~Instance() = default;
+    virtual string getInputName() = 0;
+    virtual uint32_t getBestStateCost() const = 0;
+    virtual void findMaxConnectedBipartiteSubgraph() = 0;
+};
+
+template <typename V>
+class ProblemInstance : public Instance {
+    template <typename W> friend class ProblemInstance;
+private:
+    Edge<V> edges[V::max_edges];
+    typename V::edge_index_t edges_size;
+    SolutionState<V> initial_state;
+    SolutionState<V> best_state;
     // Data parallelism
-    vector<SolutionState> solution_states_queue;
+    vector<SolutionState<V>> solution_states_queue;
+    atomic<size_t> units_done{0}; // Searched states of the frontier, for the progress reports
+    atomic<size_t> units_total{0};
+    // Checkpointing
+    vector<bool> solved_states;
+    time_point last_checkpoint_time;
+    // Anytime mode
+    uint32_t open_bound = 0; // Best cost the states left open by the time limit can reach
+    vector<uint32_t> triangle_bound; // Upper bound of the cut of the edges from i to the end, see initTriangleBounds
+    bool is_block = false; // Searched as a part of a larger instance, see findBestStateByBlocks
+    // Metrics of every thread
+    vector<SearchCounters> thread_counters;
     // Metrics
     string input_name;
     time_point start_time;
@@ -227,9 +743,9 @@ private:
         cout << "============================================" << endl;
         cout << "Result of: " << this->input_name << endl;
         cout << "--------------------------------------------" << endl;
-        vector<uint8_t> reds;
-        vector<uint8_t> blues;
-        for (uint8_t i = 0; i < this->best_state.num_of_vertices; i++)
+        vector<int> reds;
+        vector<int> blues;
+        for (int i = 0; i < this->best_state.num_of_vertices; i++)
             if (this->best_state.colors[i] == RED)
                 reds.push_back(i);
             else
@@ -247,7 +763,7 @@ private:
         }
         cout << "}" << endl;
         cout << "--------------------------------------------" << endl;
-        vector<Edge> used_edges;
+        vector<Edge<V>> used_edges;
         for (int i = 0; i < edges_size; i++)
             if (best_state.colors[edges[i].u] != best_state.colors[edges[i].v])
                 used_edges.push_back(edges[i]);
@@ -260,35 +776,165 @@ private:
         cout << "--------------------------------------------" << endl;
         cout << "Weights sum = " << best_state.cost << endl;
         cout << "--------------------------------------------" << endl;
+        if (time_is_up) {
+            uint32_t upper_bound = max(best_state.cost, open_bound);
+            cout << "Time limit reached, upper bound = " << upper_bound << ", gap = " << upper_bound - best_state.cost << endl;
+            cout << "--------------------------------------------" << endl;
+        }
+        if (print_stats)
+            totalCounters().printJson(chrono::duration<double>(end_time - start_time).count(), number_of_threads);
         cout << "Took: " << prettyPrintElapsedTime(start_time, end_time) << endl;
         cout << "============================================" << endl;
+        printRecord(end_time);
+    }
+
+    void printRecord(time_point end_time) const {
+        if (output_format == "text")
+            return;
+        ResultRecord record;
+        record.backend = "parallel_data";
+        record.input = input_name;
+        record.vertices = best_state.num_of_vertices;
+        record.edges = edges_size;
+        record.cost = best_state.cost;
+        for (int i = 0; i < best_state.num_of_vertices; i++)
+            (best_state.colors[i] == RED ? record.red : record.blue).push_back(i);
+        record.elapsed_us = chrono::duration_cast<chrono::microseconds>(end_time - start_time).count();
+        record.nodes = totalCounters().nodes;
+        record.threads = number_of_threads;
+        record.ranks = 1;
+        record.print(record_output);
     }
 
-    bool noBetterSolutionPossible(SolutionState state) const {
-        if (state.cost + state.sumWeightRemainingEdges() < best_state.cost)
+    SearchCounters & threadCounters() {
+        return thread_counters[omp_get_thread_num()];
+    }
+
+    SearchCounters totalCounters() const {
+        SearchCounters total;
+        for (auto & counters : thread_counters)
+            total += counters;
+        return total;
+    }
+
+    bool noBetterSolutionPossible(SolutionState<V> state) {
+        if (state.cost + state.sumWeightRemainingEdges() < best_state.cost) {
+            threadCounters().weight_prunes++;
             return true;
-        if (state.numOfUsedEdges() + state.numOfRemainingEdges() < int(state.num_of_vertices - 1))
+        }
+        if (state.numOfUsedEdges() + state.numOfRemainingEdges() < int(state.num_of_vertices - 1)) {
+            threadCounters().edge_count_prunes++;
             return true;
+        }
         return false;
     }
 
     size_t solutionQueueLimit() {
+        // Finer split when checkpointing, a checkpoint never splits a started state
+        if (!checkpoint_path.empty())
+            return max(size_t(thread::hardware_concurrency() * 2), size_t(FRONTIER_SIZE));
         return size_t(thread::hardware_concurrency() * 2);
     }
 
+    // Children of the state in the order of findBestStateDFS, returns their number
+    int branchStates(const SolutionState<V> & state, SolutionState<V> * children) const {
+        int u = edges[state.edge_index].u;
+        int v = edges[state.edge_index].v;
+        int num_of_children = 0;
+        for (auto [color_u, color_v] : {pair{RED, BLUE}, pair{BLUE, RED}, pair{RED, RED}, pair{BLUE, BLUE}}) {
+            if ((state.colors[u] != NO_COLOR and state.colors[u] != color_u) or
+                (state.colors[v] != NO_COLOR and state.colors[v] != color_v))
+                continue;
+            SolutionState<V> & child = children[num_of_children++];
+            child = state;
+            if (color_u != color_v)
+                child.addEdge();
+            else
+                child.skipEdge();
+            child.colors[u] = color_u;
+            child.colors[v] = color_v;
+        }
+        return num_of_children;
+    }
+
+    static bool probePruned(const SolutionState<V> & state, uint32_t bound) {
+        return state.cost + state.sumWeightRemainingEdges() < bound or
+               state.numOfUsedEdges() + state.numOfRemainingEdges() < int(state.num_of_vertices - 1);
+    }
+
+    // The first leaf of findBestStateDFS, so the estimates prune with the first bound of the real search
+    void diveFirstBranches(SolutionState<V> state) {
+        SolutionState<V> children[4];
+        while (!state.isLeaf()) {
+            if (probePruned(state, best_state.cost))
+                return;
+            branchStates(state, children);
+            state = children[0];
+        }
+        if (state.isConnected() and state.isBetterThan(best_state))
+            best_state = state;
+    }
+
+    // Knuth's estimate, a random path down the tree counts every level as the product of the branching factors above
+    // it. The leaves on the way raise the bound like they do in the search.
+    double probeSubtreeSize(SolutionState<V> state, uint32_t & bound, mt19937_64 & generator) const {
+        SolutionState<V> children[4];
+        double level_size = 1;
+        double size = 1;
+        while (true) {
+            if (state.isLeaf()) {
+                if (state.isConnected() and state.cost > bound)
+                    bound = state.cost;
+                return size;
+            }
+            if (probePruned(state, bound))
+                return size;
+            int num_of_children = branchStates(state, children);
+            level_size *= num_of_children;
+            size += level_size;
+            state = children[uniform_int_distribution<int>(0, num_of_children - 1)(generator)];
+        }
+    }
+
+    double estimateSubtreeSize(const SolutionState<V> & state, mt19937_64 & generator) const {
+        uint32_t bound = best_state.cost;
+        double sum = 0;
+        for (int i = 0; i < ESTIMATE_PROBES; i++)
+            sum += probeSubtreeSize(state, bound, generator);
+        return sum / ESTIMATE_PROBES;
+    }
+
+    // Splits the largest estimated subtree until every work unit is a small share of the tree
     void generateStatesQueue() {
+        mt19937_64 generator(0x5eed);
+        diveFirstBranches(initial_state);
         this->solution_states_queue.push_back(initial_state);
-        while (solution_states_queue.size() < solutionQueueLimit()) {
-            findBestStateBFS(solution_states_queue.front());
-            solution_states_queue.erase(solution_states_queue.begin());
+        vector<double> subtree_sizes = {estimateSubtreeSize(initial_state, generator)};
+        double unit_size = subtree_sizes[0] / double(size_t(number_of_threads) * UNITS_PER_WORKER);
+        size_t max_queue_size = max(solutionQueueLimit(), size_t(FRONTIER_SIZE));
+        while (!solution_states_queue.empty() and solution_states_queue.size() < max_queue_size) {
+            size_t largest = max_element(subtree_sizes.begin(), subtree_sizes.end()) - subtree_sizes.begin();
+            if (solution_states_queue.size() >= solutionQueueLimit() and subtree_sizes[largest] <= unit_size)
+                break;
+            SolutionState<V> state = solution_states_queue[largest];
+            solution_states_queue.erase(solution_states_queue.begin() + long(largest));
+            subtree_sizes.erase(subtree_sizes.begin() + long(largest));
+            findBestStateBFS(state);
+            while (subtree_sizes.size() < solution_states_queue.size())
+                subtree_sizes.push_back(estimateSubtreeSize(solution_states_queue[subtree_sizes.size()], generator));
         }
     }
 
-    void findBestStateBFS(SolutionState state) {
+    void findBestStateBFS(SolutionState<V> state) {
         // Check if better solution found
+        threadCounters().countNode();
         if (state.isLeaf()) {
+            threadCounters().leaves++;
             if (state.isConnected() and state.isBetterThan(best_state)) {
                 best_state = state;
+                threadCounters().countImprovement(state.cost);
+                if (time_limit > 0)
+                    printImprovement();
                 return;
             } else {
                 return;
@@ -303,34 +949,34 @@ private:
         if ((state.colors[u] == RED and state.colors[v] == RED) or
             (state.colors[u] == BLUE and state.colors[v] == BLUE)){
             {
-                SolutionState opt_skip = state;
+                SolutionState<V> opt_skip = state;
                 opt_skip.skipEdge();
                 solution_states_queue.push_back(opt_skip);
             }
         } else if (state.colors[u] == NO_COLOR and state.colors[v] == NO_COLOR) {
             {
-                SolutionState opt_add_red_blue = state;
+                SolutionState<V> opt_add_red_blue = state;
                 opt_add_red_blue.addEdge();
                 opt_add_red_blue.colors[u] = RED;
                 opt_add_red_blue.colors[v] = BLUE;
                 solution_states_queue.push_back(opt_add_red_blue);
             }
             {
-                SolutionState opt_add_blue_red = state;
+                SolutionState<V> opt_add_blue_red = state;
                 opt_add_blue_red.addEdge();
                 opt_add_blue_red.colors[u] = BLUE;
                 opt_add_blue_red.colors[v] = RED;
                 solution_states_queue.push_back(opt_add_blue_red);
             }
             {
-                SolutionState opt_skip_red_red = state;
+                SolutionState<V> opt_skip_red_red = state;
                 opt_skip_red_red.skipEdge();
                 opt_skip_red_red.colors[u] = RED;
                 opt_skip_red_red.colors[v] = RED;
                 solution_states_queue.push_back(opt_skip_red_red);
             }
             {
-                SolutionState opt_skip_blue_blue = state;
+                SolutionState<V> opt_skip_blue_blue = state;
                 opt_skip_blue_blue.skipEdge();
                 opt_skip_blue_blue.colors[u] = BLUE;
                 opt_skip_blue_blue.colors[v] = BLUE;
@@ -339,13 +985,13 @@ private:
         } else if ((state.colors[u] == RED and state.colors[v] == NO_COLOR) or
                    (state.colors[u] == BLUE and state.colors[v] == NO_COLOR)) {
             {
-                SolutionState opt_add_opposite = state;
+                SolutionState<V> opt_add_opposite = state;
                 opt_add_opposite.addEdge();
-                opt_add_opposite.colors[v] = SolutionState::getOppositeColor(opt_add_opposite.colors[u]);
+                opt_add_opposite.colors[v] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[u]);
                 solution_states_queue.push_back(opt_add_opposite);
             }
             {
-                SolutionState opt_skip_same = state;
+                SolutionState<V> opt_skip_same = state;
                 opt_skip_same.skipEdge();
                 opt_skip_same.colors[v] = opt_skip_same.colors[u];
                 solution_states_queue.push_back(opt_skip_same);
@@ -353,13 +999,13 @@ private:
         } else if ((state.colors[u] == NO_COLOR and state.colors[v] == RED) or
                    (state.colors[u] == NO_COLOR and state.colors[v] == BLUE)) {
             {
-                SolutionState opt_add_opposite = state;
+                SolutionState<V> opt_add_opposite = state;
                 opt_add_opposite.addEdge();
-                opt_add_opposite.colors[u] = SolutionState::getOppositeColor(opt_add_opposite.colors[v]);
+                opt_add_opposite.colors[u] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[v]);
                 solution_states_queue.push_back(opt_add_opposite);
             }
             {
-                SolutionState opt_skip_same = state;
+                SolutionState<V> opt_skip_same = state;
                 opt_skip_same.skipEdge();
                 opt_skip_same.colors[u] = opt_skip_same.colors[v];
                 solution_states_queue.push_back(opt_skip_same);
@@ -367,21 +1013,435 @@ private:
         } else if ((state.colors[u] == RED and state.colors[v] == BLUE) or
                    (state.colors[u] == BLUE and state.colors[v] == RED)) {
             {
-                SolutionState opt_add = state;
+                SolutionState<V> opt_add = state;
                 opt_add.addEdge();
                 solution_states_queue.push_back(opt_add);
             }
         }
     }
 
-    void findBestStateDFS(SolutionState state) {
+    // Upper bound of the cut of the edges from i to the end. Every triangle has an edge that is not cut, so the lightest
+    // edge of every triangle of an edge disjoint packing is left out of the weight of the suffix. The packing is greedy
+    // from the last edge, the packing of a suffix is the one of the shorter suffix and a triangle of its first edge.
+    void initTriangleBounds() {
+        int n = initial_state.num_of_vertices;
+        vector<int> edge_of(size_t(n) * n, -1);
+        for (int i = 0; i < edges_size; i++)
+            edge_of[edges[i].u * n + edges[i].v] = edge_of[edges[i].v * n + edges[i].u] = i;
+        vector<bool> packed(edges_size, false);
+        triangle_bound.assign(edges_size + 1, 0);
+        uint32_t suffix_weight = 0;
+        uint32_t uncut_weight = 0;
+        for (int i = edges_size - 1; i >= 0; i--) {
+            int u = edges[i].u;
+            int v = edges[i].v;
+            suffix_weight += edges[i].weight;
+            int third = -1;
+            uint32_t lightest = 0;
+            for (int w = 0; w < n; w++) {
+                int a = edge_of[u * n + w];
+                int b = edge_of[v * n + w];
+                if (a <= i or b <= i or packed[a] or packed[b])
+                    continue;
+                uint32_t weight = min({uint32_t(edges[i].weight), uint32_t(edges[a].weight), uint32_t(edges[b].weight)});
+                if (weight > lightest) {
+                    lightest = weight;
+                    third = w;
+                }
+            }
+            if (third >= 0) {
+                packed[i] = packed[edge_of[u * n + third]] = packed[edge_of[v * n + third]] = true;
+                uncut_weight += lightest;
+            }
+            triangle_bound[i] = suffix_weight - uncut_weight;
+        }
+    }
+
+    // Best cost an open state can reach by its remaining edges, the triangle bound is much tighter than their weight
+    uint32_t openStateBound(const SolutionState<V> & state) {
+        if (triangle_bound.empty())
+            initTriangleBounds();
+        return state.cost + min(state.sumWeightRemainingEdges(), triangle_bound[state.edge_index]);
+    }
+
+    void search() {
+        initial_state.edges = this->edges;
+        if (initial_state.isBipartite() and initial_state.isConnected()) {
+            best_state = initial_state;
+            // Every edge is cut, a bipartite block is also bounded by its whole weight
+            setCutOfColoring();
+        } else if (!findBestStateByTreeDecomposition() and !findBestStateGray()) {
+            initial_state.resetSolution();
+            if (resume and Checkpoint<V>::load(checkpoint_path, input_name, initial_state, best_state, solution_states_queue)) {
+                cout << "Resumed from " << checkpoint_path << ", open states: " << solution_states_queue.size() << endl;
+            } else {
+                if (resume)
+                    cout << "No valid checkpoint for " << input_name << " in " << checkpoint_path << ", starting from scratch." << endl;
+                generateStatesQueue();
+            }
+            units_total = solution_states_queue.size();
+            solved_states.assign(solution_states_queue.size(), false);
+            thread_counters[0].tasks += solution_states_queue.size();
+            last_checkpoint_time = chrono::high_resolution_clock::now();
+            #pragma omp parallel for num_threads(number_of_threads)
+            for (size_t i = 0; i < solution_states_queue.size(); i++) {
+                findBestStateDFS(solution_states_queue[i]);
+                // A state interrupted by the time limit stays open
+                if (timeIsUp())
+                    continue;
+                #pragma omp critical
+                {
+                    solved_states[i] = true;
+                    units_done++;
+                    if (!checkpoint_path.empty())
+                        saveCheckpoint();
+                }
+            }
+            if (timeIsUp()) {
+                vector<SolutionState<V>> frontier;
+                for (size_t i = 0; i < solution_states_queue.size(); i++)
+                    if (!solved_states[i])
+                        frontier.push_back(solution_states_queue[i]);
+                for (auto & state : frontier)
+                    open_bound = max(open_bound, openStateBound(state));
+                // Keep the open states, the search can be resumed with more time
+                if (!checkpoint_path.empty())
+                    Checkpoint<V>::save(checkpoint_path, input_name, best_state, frontier);
+            } else if (!checkpoint_path.empty()) {
+                // The checkpoint always belongs to the instance in progress
+                fs::remove(checkpoint_path);
+            }
+        }
+    }
+
+    // Tarjan's algorithm, the edges of every biconnected block are popped from the edge stack
+    void findBlocks(int v, int parent_edge, const vector<vector<pair<int, int>>> & adjacency, vector<int> & discovery,
+                    vector<int> & low, int & time, vector<int> & edge_stack, vector<vector<int>> & blocks) const {
+        discovery[v] = low[v] = ++time;
+        for (auto [w, e] : adjacency[v]) {
+            if (e == parent_edge)
+                continue;
+            if (discovery[w] == 0) {
+                edge_stack.push_back(e);
+                findBlocks(w, e, adjacency, discovery, low, time, edge_stack, blocks);
+                low[v] = min(low[v], low[w]);
+                if (low[w] >= discovery[v]) {
+                    blocks.emplace_back();
+                    int top;
+                    do {
+                        top = edge_stack.back();
+                        edge_stack.pop_back();
+                        blocks.back().push_back(top);
+                    } while (top != e);
+                }
+            } else if (discovery[w] < discovery[v]) {
+                edge_stack.push_back(e);
+                low[v] = min(low[v], discovery[w]);
+            }
+        }
+    }
+
+    // Searches one block as a separate instance, returns the upper bound of its cost
+    template <typename W>
+    uint32_t solveBlock(const vector<InputEdge> & block_edges, int num_of_vertices, vector<color_t> & block_colors) {
+        auto block = make_unique<ProblemInstance<W>>(input_name, num_of_vertices, block_edges);
+        block->is_block = true;
+        block->start_time = start_time;
+        bool costs_of_graph = search_progress.hideCosts();
+        block->search();
+        search_progress.restore(costs_of_graph);
+        thread_counters[0] += block->totalCounters();
+        block_colors.assign(block->best_state.colors, block->best_state.colors + num_of_vertices);
+        return max(block->best_state.cost, block->open_bound);
+    }
+
+    // The optimum is the sum of the optima of the biconnected blocks, because the coloring of a block can be
+    // flipped to agree with the rest of the graph on its articulation point. Bridges and pendant edges are
+    // blocks of a single edge. Returns false if the graph is a single block.
+    bool findBestStateByBlocks() {
+        int n = initial_state.num_of_vertices;
+        vector<vector<pair<int, int>>> adjacency(n);
+        for (int i = 0; i < edges_size; i++) {
+            adjacency[edges[i].u].emplace_back(edges[i].v, i);
+            adjacency[edges[i].v].emplace_back(edges[i].u, i);
+        }
+        vector<int> discovery(n, 0);
+        vector<int> low(n, 0);
+        vector<int> edge_stack;
+        vector<vector<int>> blocks;
+        int time = 0;
+        if (n > 0)
+            findBlocks(0, -1, adjacency, discovery, low, time, edge_stack, blocks);
+        if (blocks.size() <= 1 or find(discovery.begin(), discovery.end(), 0) != discovery.end())
+            return false;
+        size_t largest_block = 0;
+        for (auto & block : blocks)
+            largest_block = max(largest_block, block.size());
+        cout << "Preprocessing: " << blocks.size() << " biconnected blocks, the largest has " << largest_block << " edges" << endl;
+        // Search every block with its vertices renumbered from 0
+        vector<vector<int>> block_vertices(blocks.size());
+        vector<vector<color_t>> block_colors(blocks.size());
+        vector<int> local(n, -1);
+        uint32_t upper_bound = 0;
+        for (size_t b = 0; b < blocks.size(); b++) {
+            vector<InputEdge> block_edges;
+            for (int e : blocks[b]) {
+                for (int vertex : {int(edges[e].u), int(edges[e].v)}) {
+                    if (local[vertex] < 0) {
+                        local[vertex] = int(block_vertices[b].size());
+                        block_vertices[b].push_back(vertex);
+                    }
+                }
+                block_edges.emplace_back(local[edges[e].u], local[edges[e].v], edges[e].weight);
+            }
+            for (int vertex : block_vertices[b])
+                local[vertex] = -1;
+            int block_size = int(block_vertices[b].size());
+            if (block_size <= Vertices64::max_vertices)
+                upper_bound += solveBlock<Vertices64>(block_edges, block_size, block_colors[b]);
+            else if (block_size <= Vertices150::max_vertices)
+                upper_bound += solveBlock<Vertices150>(block_edges, block_size, block_colors[b]);
+            else
+                upper_bound += solveBlock<Vertices1024>(block_edges, block_size, block_colors[b]);
+        }
+        // Walk the block tree, every next block shares exactly one colored vertex with the blocks before it
+        vector<vector<int>> vertex_blocks(n);
+        for (size_t b = 0; b < blocks.size(); b++)
+            for (int vertex : block_vertices[b])
+                vertex_blocks[vertex].push_back(int(b));
+        initial_state.edges = this->edges;
+        best_state = initial_state;
+        vector<bool> block_done(blocks.size(), false);
+        queue<int> blocks_queue;
+        blocks_queue.push(0);
+        block_done[0] = true;
+        while (!blocks_queue.empty()) {
+            int b = blocks_queue.front();
+            blocks_queue.pop();
+            bool flip = false;
+            for (size_t i = 0; i < block_vertices[b].size(); i++) {
+                // A block cut short by the time limit may have uncolored vertices
+                color_t color = block_colors[b][i] == BLUE ? BLUE : RED;
+                if (best_state.colors[block_vertices[b][i]] != NO_COLOR) {
+                    flip = best_state.colors[block_vertices[b][i]] != color;
+                    break;
+                }
+            }
+            for (size_t i = 0; i < block_vertices[b].size(); i++) {
+                int vertex = block_vertices[b][i];
+                color_t color = block_colors[b][i] == BLUE ? BLUE : RED;
+                best_state.colors[vertex] = flip ? SolutionState<V>::getOppositeColor(color) : color;
+                for (int next_block : vertex_blocks[vertex]) {
+                    if (!block_done[next_block]) {
+                        block_done[next_block] = true;
+                        blocks_queue.push(next_block);
+                    }
+                }
+            }
+        }
+        setCutOfColoring();
+        open_bound = upper_bound;
+        search_progress.improve(best_state.cost);
+        return true;
+    }
+
+    // Graphs of up to GRAY_MAX_VERTICES vertices can be enumerated, the auto engine does it up to GRAY_AUTO_VERTICES.
+    // Every thread enumerates whole prefixes, there are several per thread to even out the load.
+    bool findBestStateGray() {
+        int n = initial_state.num_of_vertices;
+        if (engine != "gray" and (engine != "auto" or n > GRAY_AUTO_VERTICES))
+            return false;
+        if (n < 2 or n > GRAY_MAX_VERTICES or !checkpoint_path.empty() or time_limit > 0)
+            return false;
+        GraySearch<V> search(initial_state);
+        int prefix_bits = 0;
+        while (prefix_bits < n - 1 and (1 << prefix_bits) < 8 * number_of_threads)
+            prefix_bits++;
+        vector<typename GraySearch<V>::Result> results(size_t(1) << prefix_bits);
+        uint32_t best_cost = best_state.cost;
+        #pragma omp parallel for schedule(dynamic) num_threads(number_of_threads)
+        for (size_t prefix = 0; prefix < results.size(); prefix++) {
+            results[prefix] = search.searchPrefix(uint32_t(prefix), prefix_bits, best_cost);
+            threadCounters() += results[prefix].counters;
+        }
+        thread_counters[0].tasks += results.size();
+        typename GraySearch<V>::Result result;
+        result.cost = best_cost;
+        for (auto & prefix_result : results)
+            if (prefix_result.cost > result.cost)
+                result = prefix_result;
+        if (result.cost <= best_state.cost)
+            return true;
+        best_state = initial_state;
+        best_state.resetSolution();
+        for (int i = 0; i < initial_state.num_of_vertices; i++)
+            best_state.colors[i] = (result.colors >> i) & 1 ? BLUE : RED;
+        setCutOfColoring();
+        return true;
+    }
+
+    // Completes best_state from its coloring, the used edges are the edges of the cut
+    void setCutOfColoring() {
+        for (int i = 0; i < edges_size; i++) {
+            if (best_state.colors[edges[i].u] != best_state.colors[edges[i].v]) {
+                best_state.cost += edges[i].weight;
+                best_state.used_edges++;
+            }
+        }
+        best_state.edge_index = edges_size;
+        best_state.sum_cost_all = best_state.edges_total_weight;
+    }
+
+    // The maximum cut of a connected graph is connected and spans all vertices, otherwise flipping the colors of
+    // one of its components would cut more edges. It is solved by eliminating the vertices one by one, the
+    // neighbours of an eliminated vertex form a bag of the tree decomposition. Returns false if the width of the
+    // min-degree elimination order is over max_dp_width or its tables are over DP_MAX_MIB.
+    bool findBestStateByTreeDecomposition() {
+        if (max_dp_width <= 0 or !initial_state.isConnected())
+            return false;
+        int n = initial_state.num_of_vertices;
+        vector<set<int>> neighbours(n);
+        for (int i = 0; i < edges_size; i++) {
+            neighbours[edges[i].u].insert(edges[i].v);
+            neighbours[edges[i].v].insert(edges[i].u);
+        }
+        vector<int> order;
+        vector<vector<int>> scopes(n);
+        vector<bool> eliminated(n, false);
+        int width = 0;
+        uint64_t cells = 0;
+        uint64_t max_cells = (uint64_t(DP_MAX_MIB) << 20) / 5;
+        for (int step = 0; step < n; step++) {
+            int v = -1;
+            for (int u = 0; u < n; u++)
+                if (!eliminated[u] and (v < 0 or neighbours[u].size() < neighbours[v].size()))
+                    v = u;
+            width = max(width, int(neighbours[v].size()));
+            if (width > max_dp_width)
+                return false;
+            cells += uint64_t(1) << min(int(neighbours[v].size()), 62);
+            if (cells > max_cells)
+                return false;
+            // The neighbours of v become a clique
+            scopes[v].assign(neighbours[v].begin(), neighbours[v].end());
+            for (int a : scopes[v]) {
+                neighbours[a].erase(v);
+                for (int b : scopes[v])
+                    if (a != b)
+                        neighbours[a].insert(b);
+            }
+            eliminated[v] = true;
+            order.push_back(v);
+        }
+        if (!is_block)
+            cout << "Tree decomposition of width " << width << ", solved by dynamic programming" << endl;
+        // A table of the best cost for every coloring of its scope, bit i is the color of scope[i]
+        struct Factor {
+            vector<int> scope;
+            vector<uint32_t> values;
+        };
+        vector<Factor> factors;
+        vector<vector<int>> factors_of(n);
+        for (int i = 0; i < edges_size; i++) {
+            factors.push_back({{edges[i].u, edges[i].v}, {0, edges[i].weight, edges[i].weight, 0}});
+            factors_of[edges[i].u].push_back(i);
+            factors_of[edges[i].v].push_back(i);
+        }
+        vector<bool> consumed(factors.size(), false);
+        // Color of the eliminated vertex for every coloring of its scope
+        vector<vector<uint8_t>> choices(n);
+        for (int v : order) {
+            const vector<int> & scope = scopes[v];
+            int k = int(scope.size());
+            vector<int> bucket;
+            for (int f : factors_of[v]) {
+                if (!consumed[f]) {
+                    consumed[f] = true;
+                    bucket.push_back(f);
+                }
+            }
+            // Bit of every variable of the bucket in the coloring of scope + v, v is bit k
+            vector<vector<int>> bits(bucket.size());
+            for (size_t f = 0; f < bucket.size(); f++)
+                for (int vertex : factors[bucket[f]].scope)
+                    bits[f].push_back(vertex == v ? k : int(find(scope.begin(), scope.end(), vertex) - scope.begin()));
+            Factor result{scope, vector<uint32_t>(size_t(1) << k)};
+            choices[v].assign(size_t(1) << k, 0);
+            #pragma omp parallel for num_threads(number_of_threads)
+            for (uint32_t coloring = 0; coloring < (1u << k); coloring++) {
+                uint32_t best[2] = {0, 0};
+                for (uint32_t color = 0; color < 2; color++) {
+                    uint32_t full_coloring = coloring | color << k;
+                    for (size_t f = 0; f < bucket.size(); f++) {
+                        uint32_t index = 0;
+                        for (size_t j = 0; j < bits[f].size(); j++)
+                            index |= ((full_coloring >> bits[f][j]) & 1) << j;
+                        best[color] += factors[bucket[f]].values[index];
+                    }
+                }
+                result.values[coloring] = max(best[0], best[1]);
+                choices[v][coloring] = best[1] > best[0];
+            }
+            for (int f : bucket)
+                vector<uint32_t>().swap(factors[f].values);
+            for (int vertex : scope)
+                factors_of[vertex].push_back(int(factors.size()));
+            factors.push_back(move(result));
+            consumed.push_back(false);
+        }
+        // The scope of every vertex is eliminated after it, so it is colored first
+        initial_state.resetSolution();
+        best_state = initial_state;
+        for (auto it = order.rbegin(); it != order.rend(); it++) {
+            uint32_t coloring = 0;
+            for (size_t j = 0; j < scopes[*it].size(); j++)
+                coloring |= uint32_t(best_state.colors[scopes[*it][j]] == BLUE) << j;
+            best_state.colors[*it] = choices[*it][coloring] ? BLUE : RED;
+        }
+        setCutOfColoring();
+        return true;
+    }
+
+    void printImprovement() {
+        // The cost of a block is not the cost of the instance
+        if (is_block)
+            return;
+        auto now = chrono::high_resolution_clock::now();
+        cout << "Improved: " << best_state.cost << " after " << prettyPrintElapsedTime(start_time, now) << " colors: ";
+        for (int i = 0; i < best_state.num_of_vertices; i++)
+            cout << (best_state.colors[i] == RED ? 'R' : 'B');
+        cout << endl;
+    }
+
+    void saveCheckpoint() {
+        auto now = chrono::high_resolution_clock::now();
+        if (now - last_checkpoint_time < chrono::seconds(checkpoint_interval))
+            return;
+        // States still being searched are saved as open
+        vector<SolutionState<V>> frontier;
+        for (size_t i = 0; i < solution_states_queue.size(); i++)
+            if (!solved_states[i])
+                frontier.push_back(solution_states_queue[i]);
+        Checkpoint<V>::save(checkpoint_path, input_name, best_state, frontier);
+        last_checkpoint_time = now;
+    }
+
+    void findBestStateDFS(SolutionState<V> state) {
+        if (timeIsUp())
+            return;
         // Check if better solution found
+        threadCounters().countNode();
         if (state.isLeaf()) {
+            threadCounters().leaves++;
             if (state.isConnected() and state.isBetterThan(best_state)) {
                 #pragma omp critical
                 {
-                    if(state.isBetterThan(best_state))
+                    if(state.isBetterThan(best_state)) {
                         best_state = state;
+                        threadCounters().countImprovement(state.cost);
+                        if (time_limit > 0)
+                            printImprovement();
+                    }
                 }
                 return;
             } else {
@@ -397,34 +1457,34 @@ private:
         if ((state.colors[u] == RED and state.colors[v] == RED) or
             (state.colors[u] == BLUE and state.colors[v] == BLUE)){
             {
-                SolutionState opt_skip = state;
+                SolutionState<V> opt_skip = state;
                 opt_skip.skipEdge();
                 findBestStateDFS(opt_skip);
             }
         } else if (state.colors[u] == NO_COLOR and state.colors[v] == NO_COLOR) {
             {
-                SolutionState opt_add_red_blue = state;
+                SolutionState<V> opt_add_red_blue = state;
                 opt_add_red_blue.addEdge();
                 opt_add_red_blue.colors[u] = RED;
                 opt_add_red_blue.colors[v] = BLUE;
                 findBestStateDFS(opt_add_red_blue);
             }
             {
-                SolutionState opt_add_blue_red = state;
+                SolutionState<V> opt_add_blue_red = state;
                 opt_add_blue_red.addEdge();
                 opt_add_blue_red.colors[u] = BLUE;
                 opt_add_blue_red.colors[v] = RED;
                 findBestStateDFS(opt_add_blue_red);
             }
             {
-                SolutionState opt_skip_red_red = state;
+                SolutionState<V> opt_skip_red_red = state;
                 opt_skip_red_red.skipEdge();
                 opt_skip_red_red.colors[u] = RED;
                 opt_skip_red_red.colors[v] = RED;
                 findBestStateDFS(opt_skip_red_red);
             }
             {
-                SolutionState opt_skip_blue_blue = state;
+                SolutionState<V> opt_skip_blue_blue = state;
                 opt_skip_blue_blue.skipEdge();
                 opt_skip_blue_blue.colors[u] = BLUE;
                 opt_skip_blue_blue.colors[v] = BLUE;
@@ -433,13 +1493,13 @@ private:
         } else if ((state.colors[u] == RED and state.colors[v] == NO_COLOR) or
                    (state.colors[u] == BLUE and state.colors[v] == NO_COLOR)) {
             {
-                SolutionState opt_add_opposite = state;
+                SolutionState<V> opt_add_opposite = state;
                 opt_add_opposite.addEdge();
-                opt_add_opposite.colors[v] = SolutionState::getOppositeColor(opt_add_opposite.colors[u]);
+                opt_add_opposite.colors[v] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[u]);
                 findBestStateDFS(opt_add_opposite);
             }
             {
-                SolutionState opt_skip_same = state;
+                SolutionState<V> opt_skip_same = state;
                 opt_skip_same.skipEdge();
                 opt_skip_same.colors[v] = opt_skip_same.colors[u];
                 findBestStateDFS(opt_skip_same);
@@ -447,13 +1507,13 @@ private:
         } else if ((state.colors[u] == NO_COLOR and state.colors[v] == RED) or
                    (state.colors[u] == NO_COLOR and state.colors[v] == BLUE)) {
             {
-                SolutionState opt_add_opposite = state;
+                SolutionState<V> opt_add_opposite = state;
                 opt_add_opposite.addEdge();
-                opt_add_opposite.colors[u] = SolutionState::getOppositeColor(opt_add_opposite.colors[v]);
+                opt_add_opposite.colors[u] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[v]);
                 findBestStateDFS(opt_add_opposite);
             }
             {
-                SolutionState opt_skip_same = state;
+                SolutionState<V> opt_skip_same = state;
                 opt_skip_same.skipEdge();
                 opt_skip_same.colors[u] = opt_skip_same.colors[v];
                 findBestStateDFS(opt_skip_same);
@@ -461,47 +1521,61 @@ private:
         } else if ((state.colors[u] == RED and state.colors[v] == BLUE) or
                    (state.colors[u] == BLUE and state.colors[v] == RED)) {
             {
-                SolutionState opt_add = state;
+                SolutionState<V> opt_add = state;
                 opt_add.addEdge();
                 findBestStateDFS(opt_add);
             }
         }
     }
 public:
-    ProblemInstance(string input_name, int num_of_vertices, vector<Edge> edges) {
-        for (edges_size = 0; edges_size < min(sizeof(this->edges), edges.size()); edges_size++) {
-            this->edges[edges_size] = edges[edges_size];
+    ProblemInstance(string input_name, int num_of_vertices, const vector<InputEdge> & edges) {
+        // Inputs are dispatched by their size, so all the edges fit
+        for (edges_size = 0; size_t(edges_size) < min<size_t>(V::max_edges, edges.size()); edges_size++) {
+            this->edges[edges_size] = Edge<V>(edges[edges_size].u, edges[edges_size].v, edges[edges_size].weight);
             this->initial_state.edges_total_weight += edges[edges_size].weight;
         }
-        sort(this->edges, this->edges + edges_size, greater<>());
+        // Binary inputs are sorted already
+        if (!is_sorted(this->edges, this->edges + edges_size, greater<>()))
+            sort(this->edges, this->edges + edges_size, greater<>());
         initial_state.num_of_vertices = num_of_vertices;
         initial_state.edges_size = edges_size;
         best_state = this->initial_state;
 
         this->input_name = std::move(input_name);
+        thread_counters.resize(max(number_of_threads, 1));
     }
 
-    string getInputName() {
+    string getInputName() override {
         return input_name;
     }
 
-    uint32_t getBestStateCost() const {
+    uint32_t getBestStateCost() const override {
         return best_state.cost;
     }
 
-    void findMaxConnectedBipartiteSubgraph() {
+    // Called by the progress reporter while the search runs
+    ProgressSample progressSample() const {
+        ProgressSample sample;
+        sample.nodes = search_progress.nodes.load(memory_order_relaxed);
+        sample.best_cost = search_progress.best_cost.load(memory_order_relaxed);
+        sample.units_done = units_done.load(memory_order_relaxed);
+        sample.units_total = units_total.load(memory_order_relaxed);
+        return sample;
+    }
+
+    void findMaxConnectedBipartiteSubgraph() override {
         start_time = chrono::high_resolution_clock::now();
-        initial_state.edges = this->edges;
-        if (initial_state.isBipartite() and initial_state.isConnected()) {
-            best_state = initial_state;
-        } else {
-            initial_state.resetSolution();
-            generateStatesQueue();
-            #pragma omp parallel for num_threads(number_of_threads)
-            for (auto & solution_state : solution_states_queue) {
-                findBestStateDFS(solution_state);
-            }
-        }
+        deadline = start_time + chrono::seconds(time_limit);
+        time_is_up = false;
+        // Reports until the result is printed
+        unique_ptr<ProgressReporter> progress_reporter;
+        search_progress.reset();
+        if (progress_interval > 0)
+            progress_reporter = make_unique<ProgressReporter>(input_name, [this] { return progressSample(); });
+        // A checkpoint holds the states of one search, so checkpointed runs search the whole graph
+        if (!preprocess or !checkpoint_path.empty() or !findBestStateByBlocks())
+            search();
+        progress_reporter.reset();
         printResult();
     }
 };
@@ -515,42 +1589,144 @@ public:
         cout << "   -h, --help                  Výpíše tuto zprávu." << endl;
         cout << "   --file <filepath>...        Spustí program pro soubory." << endl;
         cout << "   --folder <folderpath>...    Spustí program pro složky." << endl;
+        cout << "   --checkpoint <file>         Průběžně ukládá stav prohledávání do souboru." << endl;
+        cout << "   --checkpoint-interval <s>   Interval ukládání v sekundách. Defaultní hodnota je 60." << endl;
+        cout << "   --resume <file>             Pokračuje ve výpočtu uloženém v souboru a dále do něj ukládá." << endl;
+        cout << "   --time-limit <s>            Časový limit v sekundách. Vypisuje každé zlepšení a skončí s nejlepším řešením." << endl;
+        cout << "   --dp-width <k>              Největší šířka stromového rozkladu řešená dynamickým programováním. Defaultní hodnota je 22, 0 vypne." << endl;
+        cout << "                               Rozklad s tabulkami přes 1 GiB se nepoužije, graf se prohledá." << endl;
+        cout << "   --engine <auto|edge|gray>   Větvení po hranách, nebo paralelní výčet všech obarvení v Grayově kódu (do 32 vrcholů)." << endl;
+        cout << "                               Auto vyčísluje grafy do 20 vrcholů. S --checkpoint a --time-limit vždy po hranách." << endl;
+        cout << "   --no-preprocess             Vypne rozklad grafu na 2-souvislé komponenty před prohledáváním." << endl;
+        cout << "   --progress <s>              Každých s sekund vypíše na chybový výstup uzly za sekundu, nejlepší cenu, podíl hotových" << endl;
+        cout << "                               stavů fronty a odhad zbývajícího času. Defaultně vypnuto." << endl;
+        cout << "   --progress-file <file>      Poslední zprávu o průběhu zapisuje do souboru místo chybového výstupu." << endl;
+        cout << "   --stats                     Vypíše počítadla prohledávání (uzly, listy, ořezání, zlepšení, úlohy) jako JSON." << endl;
+        cout << "   --output <json|csv>         Vypíše výsledek každého vstupu jako záznam na standardní výstup, text jde na chybový výstup." << endl;
         cout << "Parametry jsou vyhodnocvány v pořadí." << endl;
         cout << "Jorge Zuňiga 2023" << endl;
     }
 
-    static vector<ProblemInstance> readFromFile(const string & input_file_path) {
-        vector<ProblemInstance> inputs;
-        cout << "Loaded file " << input_file_path << endl;
-        if (!fs::exists(fs::path(input_file_path))) {
-            cout << "File \"" << input_file_path << "\' does not exist." << endl;
-            return inputs;
+    // Reads the next integer, skips anything before it
+    static int scanInt(const char * & it, const char * end) {
+        while (it != end and (*it < '0' or *it > '9') and *it != '-')
+            it++;
+        bool negative = it != end and *it == '-';
+        if (negative)
+            it++;
+        int value = 0;
+        while (it != end and '0' <= *it and *it <= '9')
+            value = value * 10 + (*it++ - '0');
+        return negative ? -value : value;
+    }
+
+    // Skips the next number without converting it
+    static void skipInt(const char * & it, const char * end) {
+        while (it != end and *it <= ' ')
+            it++;
+        while (it != end and *it > ' ')
+            it++;
+    }
+
+    // Binary instance, the edges are already filtered and sorted, see converter/converter.cpp
+    static bool parseBinary(const char * it, const char * end, int & num_of_vertices, vector<InputEdge> & edges) {
+        // Vertices are stored as bytes, so binary instances always fit in Vertices150
+        using BinaryEdge = Edge<Vertices150>;
+        static_assert(sizeof(BinaryEdge) == 3, "Edges are stored as three bytes");
+        // The edge count is little endian whatever the host is
+        uint8_t n = uint8_t(it[4]);
+        uint16_t edges_size = uint16_t(uint8_t(it[5]) | uint8_t(it[6]) << 8);
+        const BinaryEdge * edges_begin = reinterpret_cast<const BinaryEdge *>(it + BINARY_HEADER_SIZE);
+        if (n > Vertices150::max_vertices or edges_size > Vertices150::max_edges or end - it < BINARY_HEADER_SIZE + edges_size * long(sizeof(BinaryEdge)))
+            return false;
+        num_of_vertices = n;
+        edges.reserve(edges_size);
+        for (const BinaryEdge * edge = edges_begin; edge != edges_begin + edges_size; edge++) {
+            // A malformed file would index past the vertices
+            if (edge->u >= n or edge->v >= n or edge->u == edge->v or edge->weight < MIN_WEIGHT or edge->weight > MAX_WEIGHT)
+                return false;
+            edges.emplace_back(edge->u, edge->v, edge->weight);
         }
-        ifstream input_file(input_file_path);
-        if (!input_file.is_open()) {
-            cout << "Error opening " << input_file_path << endl;
-            return inputs;
+        return true;
+    }
+
+    // The file is mapped into memory, only the upper triangle of the matrix is converted
+    static bool parseFile(const string & input_file_path, int & num_of_vertices, vector<InputEdge> & edges) {
+        int fd = open(input_file_path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) < 0 or file_stat.st_size == 0) {
+            close(fd);
+            return false;
         }
-        int num_of_vertices = 0;
-        vector<Edge> edges;
-        input_file >> num_of_vertices;
-        for (int row = 0; row < num_of_vertices; row ++) {
-            for (int column = 0; column < num_of_vertices; column++) {
-                int weight;
-                input_file >> weight;
-                if (column > row and MIN_WEIGHT <= weight and weight <= MAX_WEIGHT) {
-                    Edge edge(row, column, weight);
-                    edges.push_back(edge);
+        size_t size = file_stat.st_size;
+        void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        const char * it = static_cast<const char *>(data);
+        const char * end = it + size;
+        bool parsed = true;
+        if (size >= BINARY_HEADER_SIZE and memcmp(it, BINARY_MAGIC, 4) == 0) {
+            parsed = parseBinary(it, end, num_of_vertices, edges);
+        } else {
+            num_of_vertices = scanInt(it, end);
+            // Too large inputs are reported by the caller
+            if (num_of_vertices > Vertices1024::max_vertices)
+                num_of_vertices = -num_of_vertices;
+            edges.reserve(max(num_of_vertices, 0) * max(num_of_vertices - 1, 0) / 2);
+            for (int row = 0; row < num_of_vertices; row++) {
+                for (int column = 0; column <= row; column++)
+                    skipInt(it, end);
+                for (int column = row + 1; column < num_of_vertices; column++) {
+                    int weight = scanInt(it, end);
+                    if (MIN_WEIGHT <= weight and weight <= MAX_WEIGHT)
+                        edges.emplace_back(row, column, weight);
                 }
             }
         }
-        input_file.close();
-        inputs.emplace_back(input_file_path, num_of_vertices, edges);
+        munmap(data, size);
+        return parsed;
+    }
+
+    // Every input is solved with the smallest vertex count class it fits in
+    static unique_ptr<Instance> makeInstance(const string & input_file_path, int num_of_vertices, const vector<InputEdge> & edges) {
+        if (num_of_vertices <= Vertices64::max_vertices)
+            return make_unique<ProblemInstance<Vertices64>>(input_file_path, num_of_vertices, edges);
+        if (num_of_vertices <= Vertices150::max_vertices)
+            return make_unique<ProblemInstance<Vertices150>>(input_file_path, num_of_vertices, edges);
+        return make_unique<ProblemInstance<Vertices1024>>(input_file_path, num_of_vertices, edges);
+    }
+
+    static vector<unique_ptr<Instance>> readFromFiles(const vector<string> & input_file_paths) {
+        vector<int> nums_of_vertices(input_file_paths.size(), 0);
+        vector<vector<InputEdge>> edges(input_file_paths.size());
+        vector<char> parsed(input_file_paths.size(), false);
+        #pragma omp parallel for schedule(dynamic) num_threads(number_of_threads)
+        for (size_t i = 0; i < input_file_paths.size(); i++)
+            parsed[i] = parseFile(input_file_paths[i], nums_of_vertices[i], edges[i]);
+        vector<unique_ptr<Instance>> inputs;
+        for (size_t i = 0; i < input_file_paths.size(); i++) {
+            cout << "Loaded file " << input_file_paths[i] << endl;
+            if (!fs::exists(fs::path(input_file_paths[i])))
+                cout << "File \"" << input_file_paths[i] << "\' does not exist." << endl;
+            else if (!parsed[i])
+                cout << "Error opening " << input_file_paths[i] << endl;
+            else if (nums_of_vertices[i] < 0)
+                cout << "Too many vertices in " << input_file_paths[i] << ", at most " << Vertices1024::max_vertices << " are supported." << endl;
+            else
+                inputs.push_back(makeInstance(input_file_paths[i], nums_of_vertices[i], edges[i]));
+        }
         return inputs;
     }
 
-    static vector<ProblemInstance> readFromFolder(const string & input_folder_path) {
-        vector<ProblemInstance> inputs;
+    static vector<unique_ptr<Instance>> readFromFile(const string & input_file_path) {
+        return readFromFiles({input_file_path});
+    }
+
+    static vector<unique_ptr<Instance>> readFromFolder(const string & input_folder_path) {
+        vector<unique_ptr<Instance>> inputs;
         cout << "Loaded folder " << input_folder_path << endl;
         if ( ! fs::is_directory(fs::path(input_folder_path))) {
             cout << "Folder \"" << input_folder_path << "\" does not exist" << endl;
@@ -561,15 +1737,11 @@ public:
             paths_to_files.push_back(entry.path());
         }
         sort(paths_to_files.begin(), paths_to_files.end());
-        for (const auto & file_path : paths_to_files) {
-            vector<ProblemInstance> input = readFromFile(file_path);
-            inputs.insert(inputs.end(), input.begin(), input.end());
-        }
-        return inputs;
+        return readFromFiles(paths_to_files);
     }
 
-    static vector<ProblemInstance> readInput(int argc, char* argv[]) {
-        vector<ProblemInstance> inputs;
+    static vector<unique_ptr<Instance>> readInput(int argc, char* argv[]) {
+        vector<unique_ptr<Instance>> inputs;
         vector<string> args(argv + 1, argv+argc);
         // Find flags -h, --help, --file <filepath>..., --folder <folderpath>...
         bool help_arg_found_short = find(args.begin(), args.end(), "-h") != args.end();
@@ -586,6 +1758,68 @@ public:
             InputHandler::printHelp();
             return inputs;
         }
+        // If --output json|csv is found, print a record per instance and move the text to the standard error
+        auto output_arg_it = find(args.begin(), args.end(), "--output");
+        if (output_arg_it != args.end() and next(output_arg_it) != args.end()) {
+            output_format = *next(output_arg_it);
+            if (output_format == "json" or output_format == "csv") {
+                cout.rdbuf(cerr.rdbuf());
+            } else {
+                cout << "Unknown output format " << output_format << endl;
+                output_format = "text";
+            }
+        }
+        // If --checkpoint <file> or --resume <file> is found, checkpoint the search into the file
+        auto checkpoint_arg_it = find(args.begin(), args.end(), "--checkpoint");
+        if (checkpoint_arg_it != args.end() and next(checkpoint_arg_it) != args.end())
+            checkpoint_path = *next(checkpoint_arg_it);
+        auto resume_arg_it = find(args.begin(), args.end(), "--resume");
+        if (resume_arg_it != args.end() and next(resume_arg_it) != args.end()) {
+            checkpoint_path = *next(resume_arg_it);
+            resume = true;
+        }
+        auto checkpoint_interval_arg_it = find(args.begin(), args.end(), "--checkpoint-interval");
+        if (checkpoint_interval_arg_it != args.end() and next(checkpoint_interval_arg_it) != args.end()) {
+            istringstream iss(*next(checkpoint_interval_arg_it));
+            iss >> checkpoint_interval;
+        }
+        // If --time-limit <s> is found, stop at the deadline with the best solution found so far
+        auto time_limit_arg_it = find(args.begin(), args.end(), "--time-limit");
+        if (time_limit_arg_it != args.end() and next(time_limit_arg_it) != args.end()) {
+            istringstream iss(*next(time_limit_arg_it));
+            iss >> time_limit;
+        }
+        // If --dp-width <k> is found, solve the graphs with tree decompositions up to width k by dynamic programming
+        auto dp_width_arg_it = find(args.begin(), args.end(), "--dp-width");
+        if (dp_width_arg_it != args.end() and next(dp_width_arg_it) != args.end()) {
+            istringstream iss(*next(dp_width_arg_it));
+            iss >> max_dp_width;
+        }
+        // If --engine <auto|edge|gray> is found, enumerate the colorings or branch on the edges
+        auto engine_arg_it = find(args.begin(), args.end(), "--engine");
+        if (engine_arg_it != args.end() and next(engine_arg_it) != args.end()) {
+            engine = *next(engine_arg_it);
+            if (engine != "auto" and engine != "edge" and engine != "gray") {
+                cout << "Unknown engine " << engine << endl;
+                engine = "auto";
+            }
+        }
+        // If --no-preprocess is found, search the whole graph without splitting it into blocks
+        if (find(args.begin(), args.end(), "--no-preprocess") != args.end())
+            preprocess = false;
+        // If --progress <s> is found, report the progress of the search every s seconds
+        auto progress_arg_it = find(args.begin(), args.end(), "--progress");
+        if (progress_arg_it != args.end() and next(progress_arg_it) != args.end()) {
+            istringstream iss(*next(progress_arg_it));
+            iss >> progress_interval;
+        }
+        // If --progress-file <file> is found, keep the last progress report in the file instead of the standard error
+        auto progress_file_arg_it = find(args.begin(), args.end(), "--progress-file");
+        if (progress_file_arg_it != args.end() and next(progress_file_arg_it) != args.end())
+            progress_path = *next(progress_file_arg_it);
+        // If --stats is found, print the search counters of every instance as JSON
+        if (find(args.begin(), args.end(), "--stats") != args.end())
+            print_stats = true;
         // If -t <int> is found, set the number of threads variable
         if (thread_num_arg_found) {
             auto num_of_threads_it = next(thread_num_arg_it);
@@ -598,18 +1832,20 @@ public:
         // If --file <filepath>... is present, extract from files
         if (file_arg_found) {
             auto input_files_it = next(file_arg_it);
-            while (input_files_it != args.end() and *input_files_it != "--folder") {
-                vector<ProblemInstance> file_input = InputHandler::readFromFile(*input_files_it);
-                inputs.insert(inputs.end(), file_input.begin(), file_input.end());
+            vector<string> input_file_paths;
+            while (input_files_it != args.end() and !input_files_it->empty() and input_files_it->front() != '-') {
+                input_file_paths.push_back(*input_files_it);
                 input_files_it = next(input_files_it);
             }
+            vector<unique_ptr<Instance>> file_inputs = InputHandler::readFromFiles(input_file_paths);
+            inputs.insert(inputs.end(), make_move_iterator(file_inputs.begin()), make_move_iterator(file_inputs.end()));
         }
         // If --folder <folderpath>... is present, extract from folders
         if (folder_arg_found) {
             auto input_folders_it = next(folder_arg_it);
-            while (input_folders_it != args.end() and *input_folders_it != "--file") {
-                vector<ProblemInstance> folder_inputs = InputHandler::readFromFolder(*input_folders_it);
-                inputs.insert(inputs.end(), folder_inputs.begin(), folder_inputs.end());
+            while (input_folders_it != args.end() and !input_folders_it->empty() and input_folders_it->front() != '-') {
+                vector<unique_ptr<Instance>> folder_inputs = InputHandler::readFromFolder(*input_folders_it);
+                inputs.insert(inputs.end(), make_move_iterator(folder_inputs.begin()), make_move_iterator(folder_inputs.end()));
                 input_folders_it = next(input_folders_it);
             }
         }
@@ -619,18 +1855,22 @@ public:
 
 int main(int argc, char* argv[]) {
     // Read input
-    vector<ProblemInstance> inputs = InputHandler::readInput(argc, argv);
+    auto start_time_load = chrono::high_resolution_clock::now();
+    vector<unique_ptr<Instance>> inputs = InputHandler::readInput(argc, argv);
+    auto end_time_load = chrono::high_resolution_clock::now();
     // Measure time
     auto start_time_total = chrono::high_resolution_clock::now();
     // Find solutions
     for (auto & problem_instance : inputs)
-        problem_instance.findMaxConnectedBipartiteSubgraph();
+        problem_instance->findMaxConnectedBipartiteSubgraph();
     // End of time measure
     auto end_time_total = chrono::high_resolution_clock::now();
-    // Print total time if more than one result
-    if (inputs.size() > 1) {
+    // Print load time, total time if more than one result
+    if (!inputs.empty()) {
         cout << "============================================" << endl;
-        cout << "Total time: " << prettyPrintElapsedTime(start_time_total, end_time_total) << endl;
+        cout << "Load time: " << prettyPrintElapsedTime(start_time_load, end_time_load) << endl;
+        if (inputs.size() > 1)
+            cout << "Total time: " << prettyPrintElapsedTime(start_time_total, end_time_total) << endl;
         cout << "============================================" << endl;
     }
     // Assert
@@ -671,13 +1911,14 @@ int main(int argc, char* argv[]) {
         {"graf_30_25.txt", 21336}
     };
     // Print if wrong result
-    for (auto problem_instance : inputs) {
-        string name = fs::path(problem_instance.getInputName()).filename();
+    for (auto & problem_instance : inputs) {
+        // Binary inputs share the name of the text input
+        string name = fs::path(problem_instance->getInputName()).stem().string() + ".txt";
         if (results.count(name) > 0) {
             uint32_t expected = results[name];
-            uint32_t got = problem_instance.getBestStateCost();
+            uint32_t got = problem_instance->getBestStateCost();
             if (got != expected)
-                cout << problem_instance.getInputName() << " expected: " << expected << " got: " << got << endl;
+                cout << problem_instance->getInputName() << " expected: " << expected << " got: " << got << endl;
         }
     }
     return 0;
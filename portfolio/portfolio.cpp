@@ -0,0 +1,1087 @@
+/*
+ * Jorge Zuniga (zuniga.cz)
+ * FIT CVUT NI-PDP
+ * 2023
+ */
+#include <iostream>
+#include <utility>
+#include <vector>
+#include <array>
+#include <memory>
+#include <string>
+#include <sstream>
+#include <filesystem>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+#include <queue>
+#include <random>
+#include <cstdint>
+#include <limits>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define MAX_WEIGHT 120
+#define MIN_WEIGHT 80
+#define BINARY_MAGIC "PDPG" // Instances made by the converter
+#define BINARY_HEADER_SIZE 11
+// Most uncolored vertices whose colorings are all enumerated at the bottom of the edge search
+#define LEAF_MAX_VERTICES 16
+
+using namespace std;
+namespace fs = std::filesystem;
+using time_point = chrono::high_resolution_clock::time_point;
+
+// Portfolio
+int number_of_threads = 0; // Concurrent searches, 0 = one per core
+uint64_t seed = 1; // Seed of the tie-breaks of the edge orders
+int leaf_vertices = 10; // The searches enumerate the completions once at most this many vertices are uncolored
+
+// Statistics
+bool print_stats = false; // Print the search counters as JSON
+
+// Machine readable output, the records go to the standard output and the text to the standard error
+string output_format = "text"; // text, json or csv
+ostream record_output(cout.rdbuf());
+
+enum color_t : uint8_t {NO_COLOR, RED, BLUE};
+
+// Vertex count classes, every input is solved with the smallest one it fits in
+struct Vertices64 {
+    static constexpr int max_vertices = 64;
+    static constexpr int max_edges = 2016; // 64 choose 2
+    using vertex_t = uint8_t;
+    using edge_index_t = uint16_t;
+};
+
+struct Vertices150 {
+    static constexpr int max_vertices = 150;
+    static constexpr int max_edges = 11175; // 150 choose 2
+    using vertex_t = uint8_t;
+    using edge_index_t = uint16_t;
+};
+
+struct Vertices1024 {
+    static constexpr int max_vertices = 1024;
+    static constexpr int max_edges = 523776; // 1024 choose 2
+    using vertex_t = uint16_t;
+    using edge_index_t = int32_t;
+};
+
+template <typename V> class Edge;
+template <typename V> class SolutionState;
+class Instance;
+template <typename V> class ProblemInstance;
+class InputHandler;
+
+string prettyPrintElapsedTime(time_point start_time, time_point end_time) {
+    auto ms = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
+    auto h = chrono::duration_cast<chrono::hours>(ms);
+    ms -= chrono::duration_cast<chrono::milliseconds>(h);
+    auto m = chrono::duration_cast<chrono::minutes>(ms);
+    ms -= chrono::duration_cast<chrono::milliseconds>(m);
+    auto s = chrono::duration_cast<chrono::seconds>(ms);
+    ms -= chrono::duration_cast<chrono::milliseconds>(s);
+    ostringstream oss;
+    oss << h.count() << "h:" << m.count() << "m:" << s.count() << "." << setw(3) << setfill('0') << ms.count() << "s";
+    return oss.str();
+}
+
+string formatWithCommas(uint64_t number) {
+    string str = to_string(number);
+    int n = str.length();
+    if (n <= 3)
+        return str;
+    string formatted;
+    int count = 0;
+    for (int i = n - 1; i >= 0; i--) {
+        formatted.insert(0, 1, str[i]);
+        count++;
+        if (count % 3 == 0 && i != 0)
+            formatted.insert(0, 1, ',');
+    }
+    return formatted;
+}
+
+
+// Result of one instance for --output json or csv
+struct ResultRecord {
+    string backend;
+    string input;
+    int vertices = 0;
+    int edges = 0;
+    uint32_t cost = 0;
+    vector<int> red;
+    vector<int> blue;
+    int64_t elapsed_us = 0;
+    uint64_t nodes = 0;
+    int threads = 1;
+    int ranks = 1;
+
+    static string joined(const vector<int> & vertices, const string & separator) {
+        ostringstream oss;
+        for (size_t i = 0; i < vertices.size(); i++)
+            oss << (i > 0 ? separator : "") << vertices[i];
+        return oss.str();
+    }
+
+    static string quoted(const string & text) {
+        string escaped = "\"";
+        for (char c : text) {
+            if (c == '"' or c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped + "\"";
+    }
+
+    void print(ostream & out) const {
+        if (output_format == "json") {
+            out << "{\"backend\": " << quoted(backend) << ", \"input\": " << quoted(input)
+                << ", \"vertices\": " << vertices << ", \"edges\": " << edges << ", \"cost\": " << cost
+                << ", \"red\": [" << joined(red, ", ") << "], \"blue\": [" << joined(blue, ", ") << "]"
+                << ", \"elapsed_us\": " << elapsed_us << ", \"nodes\": " << nodes
+                << ", \"threads\": " << threads << ", \"ranks\": " << ranks << "}" << endl;
+        } else if (output_format == "csv") {
+            static bool header_printed = false;
+            if (!header_printed) {
+                out << "backend,input,vertices,edges,cost,red,blue,elapsed_us,nodes,threads,ranks" << endl;
+                header_printed = true;
+            }
+            // CSV quotes are doubled, not escaped
+            string input_field = input;
+            for (size_t i = 0; (i = input_field.find('"', i)) != string::npos; i += 2)
+                input_field.insert(i, 1, '"');
+            out << backend << ",\"" << input_field << "\"," << vertices << "," << edges << "," << cost << ","
+                << joined(red, " ") << "," << joined(blue, " ") << "," << elapsed_us << "," << nodes << ","
+                << threads << "," << ranks << endl;
+        }
+    }
+};
+
+
+// Search counters of one thread. Every thread counts into its own cache line, so the threads do not slow each
+// other down, and the counters are summed after the search.
+struct alignas(64) SearchCounters {
+    uint64_t nodes = 0;
+    uint64_t leaves = 0;
+    uint64_t weight_prunes = 0;     // The remaining weight cannot beat the best cost
+    uint64_t edge_count_prunes = 0; // Too few remaining edges to connect all vertices
+    uint64_t forced_prunes = 0;     // A vertex without a cut edge has no remaining edge that can be one
+    uint64_t forced_moves = 0;      // A vertex was colored by the only remaining edge of its neighbour
+    uint64_t improvements = 0;
+    uint64_t tasks = 0;
+
+    SearchCounters & operator += (const SearchCounters & other) {
+        nodes += other.nodes;
+        leaves += other.leaves;
+        weight_prunes += other.weight_prunes;
+        edge_count_prunes += other.edge_count_prunes;
+        forced_prunes += other.forced_prunes;
+        forced_moves += other.forced_moves;
+        improvements += other.improvements;
+        tasks += other.tasks;
+        return *this;
+    }
+    void printJson(double seconds, int threads) const {
+        cout << "{\"nodes\": " << nodes
+             << ", \"nodes_per_second\": " << uint64_t(seconds > 0 ? double(nodes) / seconds : 0.0)
+             << ", \"leaves\": " << leaves
+             << ", \"weight_prunes\": " << weight_prunes
+             << ", \"edge_count_prunes\": " << edge_count_prunes
+             << ", \"forced_prunes\": " << forced_prunes
+             << ", \"forced_moves\": " << forced_moves
+             << ", \"improvements\": " << improvements
+             << ", \"tasks\": " << tasks
+             << ", \"threads\": " << threads << "}" << endl;
+    }
+};
+
+
+template <typename V>
+class Edge {
+public:
+    typename V::vertex_t u;
+    typename V::vertex_t v;
+    uint8_t weight; // 80 <= weight <= 120
+public:
+    Edge() {
+        this->u = 0;
+        this->v = 0;
+        this->weight = 0;
+    }
+
+    Edge(int u, int v, int weight) {
+        this->u = u;
+        this->v = v;
+        this->weight = weight;
+    }
+
+    bool operator > (const Edge & other) const {
+        if (this->weight != other.weight)
+            return this->weight > other.weight;
+        else if (this->u != other.u)
+            return this->u > other.u;
+        else if (this->v != other.v)
+            return this->v > other.v;
+        return false;
+    }
+
+    friend ostream & operator << (ostream & os, const Edge & edge) {
+        os << "{(" << int(edge.u) << ", " << int(edge.v) << "), " << int(edge.weight) << "}";
+        return os;
+    }
+};
+
+// Edges as read from the input, before the instance size is known
+using InputEdge = Edge<Vertices1024>;
+
+template <typename V>
+class SolutionState {
+public:
+    color_t colors[V::max_vertices] = {NO_COLOR};
+    typename V::vertex_t num_of_vertices = 0;
+    typename V::edge_index_t edge_index = 0;
+    typename V::edge_index_t used_edges = 0;
+    uint32_t cost = 0;
+    uint32_t sum_cost_all = 0;
+    Edge<V> * edges = nullptr;
+    typename V::edge_index_t edges_size = 0;
+    uint32_t edges_total_weight = 0;
+public:
+    void resetSolution() {
+        memset(colors, NO_COLOR, sizeof(colors));
+        edge_index = 0;
+        used_edges = 0;
+        cost = 0;
+    }
+
+    bool isLeaf() const {
+        return edge_index == edges_size;
+    }
+
+    bool isBetterThan(SolutionState state) const {
+        return cost > state.cost;
+    }
+
+    bool isBipartite() {
+        unordered_map<int, vector<int>> adj_map;
+        for (int i = 0; i < edges_size; i++) {
+            adj_map[int(edges[i].u)].push_back(int(edges[i].v));
+            adj_map[int(edges[i].v)].push_back(int(edges[i].u));
+        }
+        queue<pair<int, color_t>> q;
+        for (auto & [vertex, _] : adj_map){
+            if (this->colors[vertex] == NO_COLOR){
+                this->colors[vertex] = RED;
+                q.emplace(vertex, this->colors[vertex]);
+                while(!q.empty()){
+                    pair<int, color_t> p = q.front();
+                    q.pop();
+                    int v = p.first;
+                    color_t c = p.second;
+                    for (auto & j : adj_map[v]){
+                        if (this->colors[j] == c)
+                            return false;
+                        if (this->colors[j] == NO_COLOR){
+                            this->colors[j] = SolutionState::getOppositeColor(c);
+                            q.emplace(j, this->colors[j]);
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // Union-find with path halving, an adjacency matrix would not fit on the stack for larger graphs
+    static int findRoot(typename V::vertex_t (& parent)[V::max_vertices], int v) {
+        while (parent[v] != v) {
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
+    }
+
+    bool isConnected() const {
+        typename V::vertex_t parent[V::max_vertices];
+        for (int i = 0; i < num_of_vertices; i++)
+            parent[i] = i;
+        int components = num_of_vertices;
+        for (int i = 0; i < edges_size; i++) {
+            int root_u = findRoot(parent, edges[i].u);
+            int root_v = findRoot(parent, edges[i].v);
+            if (root_u != root_v) {
+                parent[root_u] = root_v;
+                components--;
+            }
+        }
+        return components <= 1;
+    }
+
+    uint32_t sumWeightRemainingEdges() const {
+        return edges_total_weight - sum_cost_all;
+    }
+
+    int numOfUsedEdges() const {
+        return int(used_edges);
+    }
+
+    int numOfRemainingEdges() const {
+        return edges_size - edge_index;
+    }
+
+    static color_t getOppositeColor(color_t c) {
+        return (c == RED) ? BLUE : RED;
+    }
+
+    void skipEdge() {
+        sum_cost_all += edges[edge_index].weight;
+        edge_index++;
+    }
+
+    void addEdge() {
+        sum_cost_all += edges[edge_index].weight;
+        cost += edges[edge_index].weight;
+        edge_index++;
+        used_edges++;
+    }
+};
+
+
+class Instance {
+public:
+    virtual ~Instance() = default;
+    virtual string getInputName() = 0;
+    virtual uint32_t getBestStateCost() const = 0;
+    virtual void findMaxConnectedBipartiteSubgraph() = 0;
+};
+
+// Branch orders of the searches, a branch is the pair of colors of the endpoints of the edge. The branches that
+// disagree with a colored endpoint are skipped. Swapping red and blue mirrors the whole tree, so only the order of the
+// cut and the skipped edges makes a difference.
+constexpr array<array<pair<color_t, color_t>, 4>, 2> BRANCH_ORDERS = {{
+    {{{RED, BLUE}, {BLUE, RED}, {RED, RED}, {BLUE, BLUE}}}, // Cut edges first, the order of the sequential backend
+    {{{RED, RED}, {BLUE, BLUE}, {RED, BLUE}, {BLUE, RED}}}  // Skipped edges first
+}};
+
+// Several differently ordered searches of the same instance run at once and share the best solution. The first one
+// that finishes has proved it optimal, the others stop. The time of one order can be far from the others on the hard
+// instances, the portfolio takes the luckiest one. Every search is the edge search of the sequential backend with its
+// forced moves and the enumeration of the last vertices. The dynamic programming, the Gray code engine and the split
+// into blocks do not depend on the order, so they are not part of the portfolio.
+template <typename V>
+class ProblemInstance : public Instance {
+private:
+    // One search of the portfolio
+    struct Search {
+        vector<Edge<V>> edges; // Sorted by weight, the ties are broken at random except in the first search
+        const array<pair<color_t, color_t>, 4> * branch_order = nullptr;
+        vector<int> last_edge; // Index of the last edge of every vertex in the order of the search
+        // Remaining edges of every vertex without a cut edge, COVERED once it has one. Kept up to date along the
+        // branch of findBestStateDFS, every search has its own.
+        typename V::vertex_t open_degrees[V::max_vertices] = {};
+        SearchCounters counters;
+    };
+    static constexpr typename V::vertex_t COVERED = numeric_limits<typename V::vertex_t>::max();
+
+    Edge<V> edges[V::max_edges];
+    typename V::edge_index_t edges_size;
+    SolutionState<V> initial_state;
+    SolutionState<V> best_state; // Written under the lock
+    atomic<uint32_t> best_cost{0}; // Cost of best_state, read by every node of every search without the lock
+    mutex best_state_lock;
+    atomic<bool> proved{false}; // A search finished, the others stop
+    int winner = -1; // Search that proved the best solution optimal
+    vector<Search> searches;
+    // Metrics
+    string input_name;
+    time_point start_time;
+private:
+    bool noBetterSolutionPossible(Search & search, const SolutionState<V> & state) {
+        if (state.cost + state.sumWeightRemainingEdges() < best_cost.load(memory_order_relaxed)) {
+            search.counters.weight_prunes++;
+            return true;
+        }
+        if (state.numOfUsedEdges() + state.numOfRemainingEdges() < int(state.num_of_vertices - 1)) {
+            search.counters.edge_count_prunes++;
+            return true;
+        }
+        return false;
+    }
+
+    // The edges of the searches are ordered differently, so the solution is kept as a coloring
+    void offerSolution(Search & search, const SolutionState<V> & state) {
+        lock_guard<mutex> guard(best_state_lock);
+        if (state.cost <= best_state.cost)
+            return;
+        memcpy(best_state.colors, state.colors, sizeof(best_state.colors));
+        best_state.cost = state.cost;
+        best_cost.store(state.cost, memory_order_relaxed);
+        search.counters.improvements++;
+    }
+
+    // Degrees of the initial state, findBestStateDFS adds every decided edge when it enters the state
+    void countOpenDegrees(Search & search) {
+        fill(search.open_degrees, search.open_degrees + initial_state.num_of_vertices, 0);
+        for (auto & edge : search.edges) {
+            search.open_degrees[edge.u]++;
+            search.open_degrees[edge.v]++;
+        }
+        for (int i = 0; i < initial_state.num_of_vertices; i++)
+            if (search.open_degrees[i] == 0)
+                search.open_degrees[i] = COVERED;
+    }
+
+    // The last decided edge of a state in the open degrees of its search for the time of its branch. A cut edge covers
+    // its endpoints, a skipped one takes one remaining edge from each of them.
+    class OpenDegreesScope {
+    private:
+        typename V::vertex_t * open_degrees;
+        int u = 0, v = 0;
+        typename V::vertex_t degree_u = 0, degree_v = 0;
+        bool active = false;
+    public:
+        OpenDegreesScope(Search & search, const SolutionState<V> & state) : open_degrees(search.open_degrees) {
+            if (state.edge_index == 0)
+                return;
+            active = true;
+            u = search.edges[state.edge_index - 1].u;
+            v = search.edges[state.edge_index - 1].v;
+            degree_u = open_degrees[u];
+            degree_v = open_degrees[v];
+            if (state.colors[u] != state.colors[v]) {
+                open_degrees[u] = COVERED;
+                open_degrees[v] = COVERED;
+            } else {
+                if (open_degrees[u] != COVERED)
+                    open_degrees[u]--;
+                if (open_degrees[v] != COVERED)
+                    open_degrees[v]--;
+            }
+        }
+
+        ~OpenDegreesScope() {
+            if (!active)
+                return;
+            open_degrees[u] = degree_u;
+            open_degrees[v] = degree_v;
+        }
+    };
+
+    // Every vertex needs a cut edge to be connected, the endpoints of the last skipped edge may have lost their last
+    // chance. A vertex with one remaining edge has to take it, so the other endpoint gets the opposite color, the edge
+    // is the last one of the vertex. Returns false if a vertex cannot get a cut edge any more.
+    bool propagateForcedMoves(Search & search, SolutionState<V> & state) {
+        if (state.edge_index == 0)
+            return true;
+        const Edge<V> & edge = search.edges[state.edge_index - 1];
+        // Covered vertices and the ones with more remaining edges are the common case
+        if (search.open_degrees[edge.u] > 1 and search.open_degrees[edge.v] > 1)
+            return true;
+        for (int vertex : {int(edge.u), int(edge.v)}) {
+            if (search.open_degrees[vertex] == 0) {
+                search.counters.forced_prunes++;
+                return false;
+            }
+            if (search.open_degrees[vertex] != 1)
+                continue;
+            const Edge<V> & forced = search.edges[search.last_edge[vertex]];
+            int other = forced.u == vertex ? forced.v : forced.u;
+            color_t color_vertex = state.colors[vertex];
+            color_t color_other = state.colors[other];
+            if (color_vertex != NO_COLOR and color_vertex == color_other) {
+                search.counters.forced_prunes++;
+                return false;
+            }
+            if (color_vertex != NO_COLOR and color_other == NO_COLOR) {
+                state.colors[other] = SolutionState<V>::getOppositeColor(color_vertex);
+                search.counters.forced_moves++;
+            } else if (color_other != NO_COLOR and color_vertex == NO_COLOR) {
+                state.colors[vertex] = SolutionState<V>::getOppositeColor(color_other);
+                search.counters.forced_moves++;
+            }
+        }
+        return true;
+    }
+
+    // Bottom of the search, every uncolored vertex gets both colors at once. The completions are walked in Gray code
+    // order, a flip updates the cost by one row, the same as in the sequential backend.
+    void findBestStateLeaves(Search & search, const SolutionState<V> & state, const int * uncolored, int k) {
+        int position[V::max_vertices];
+        for (int i = 0; i < k; i++)
+            position[uncolored[i]] = i;
+        int32_t base = int32_t(state.cost);
+        int32_t gain_red[LEAF_MAX_VERTICES] = {0};
+        int32_t gain_blue[LEAF_MAX_VERTICES] = {0};
+        int32_t weights[LEAF_MAX_VERTICES][LEAF_MAX_VERTICES] = {{0}};
+        for (int i = state.edge_index; i < edges_size; i++) {
+            const Edge<V> & edge = search.edges[i];
+            color_t color_u = state.colors[edge.u];
+            color_t color_v = state.colors[edge.v];
+            int32_t weight = edge.weight;
+            if (color_u != NO_COLOR and color_v != NO_COLOR) {
+                base += color_u != color_v ? weight : 0;
+            } else if (color_u == NO_COLOR and color_v == NO_COLOR) {
+                weights[position[edge.u]][position[edge.v]] += weight;
+                weights[position[edge.v]][position[edge.u]] += weight;
+            } else {
+                int j = position[color_u == NO_COLOR ? edge.u : edge.v];
+                (color_u == BLUE or color_v == BLUE ? gain_red[j] : gain_blue[j]) += weight;
+            }
+        }
+        // All red first, bit i of the completion is set if vertex uncolored[i] is blue
+        int32_t cost = base;
+        for (int i = 0; i < k; i++)
+            cost += gain_red[i];
+        int32_t best_completion_cost = cost;
+        uint32_t best_completion = 0;
+        uint32_t completion = 0;
+        for (uint32_t i = 1; i < 1u << k; i++) {
+            int v = __builtin_ctz(i);
+            int32_t bit_v = (completion >> v) & 1;
+            cost += bit_v ? gain_red[v] - gain_blue[v] : gain_blue[v] - gain_red[v];
+            for (int j = 0; j < k; j++)
+                cost += int32_t(((completion >> j) & 1) == uint32_t(bit_v)) * 2 * weights[v][j] - weights[v][j];
+            completion ^= 1u << v;
+            if (cost > best_completion_cost) {
+                best_completion_cost = cost;
+                best_completion = completion;
+            }
+        }
+        search.counters.leaves += 1u << k;
+        if (uint32_t(best_completion_cost) <= best_cost.load(memory_order_relaxed) or !state.isConnected())
+            return;
+        SolutionState<V> leaf = state;
+        for (int i = 0; i < k; i++)
+            leaf.colors[uncolored[i]] = (best_completion >> i) & 1 ? BLUE : RED;
+        leaf.cost = uint32_t(best_completion_cost);
+        offerSolution(search, leaf);
+    }
+
+    void findBestStateDFS(Search & search, SolutionState<V> & state) {
+        if (proved.load(memory_order_relaxed))
+            return;
+        // Count recursive calls
+        search.counters.nodes++;
+        // Check if better solution found
+        if (state.isLeaf()) {
+            search.counters.leaves++;
+            if (state.isConnected() and state.cost > best_cost.load(memory_order_relaxed))
+                offerSolution(search, state);
+            return;
+        }
+        // Cut the tree of solutions
+        if (noBetterSolutionPossible(search, state))
+            return;
+        OpenDegreesScope open_degrees_scope(search, state);
+        if (!propagateForcedMoves(search, state))
+            return;
+        // Enumerate the completions of the last few uncolored vertices
+        if (leaf_vertices > 0) {
+            int uncolored[V::max_vertices];
+            int k = 0;
+            for (int i = 0; i < state.num_of_vertices; i++)
+                if (state.colors[i] == NO_COLOR)
+                    uncolored[k++] = i;
+            if (k <= leaf_vertices) {
+                findBestStateLeaves(search, state, uncolored, k);
+                return;
+            }
+        }
+        int u = search.edges[state.edge_index].u;
+        int v = search.edges[state.edge_index].v;
+        for (auto [color_u, color_v] : *search.branch_order) {
+            if ((state.colors[u] != NO_COLOR and state.colors[u] != color_u) or
+                (state.colors[v] != NO_COLOR and state.colors[v] != color_v))
+                continue;
+            SolutionState<V> next_state = state;
+            if (color_u != color_v)
+                next_state.addEdge();
+            else
+                next_state.skipEdge();
+            next_state.colors[u] = color_u;
+            next_state.colors[v] = color_v;
+            findBestStateDFS(search, next_state);
+        }
+    }
+
+    // Search i takes the branches in order i mod 2, every search but the first breaks the ties of the weights at random
+    void initSearches(int num_of_searches) {
+        searches.resize(num_of_searches);
+        for (int i = 0; i < num_of_searches; i++) {
+            Search & search = searches[i];
+            search.edges.assign(edges, edges + edges_size);
+            search.branch_order = &BRANCH_ORDERS[i % BRANCH_ORDERS.size()];
+            if (i > 0) {
+                mt19937_64 generator(seed + uint64_t(i));
+                shuffle(search.edges.begin(), search.edges.end(), generator);
+                stable_sort(search.edges.begin(), search.edges.end(),
+                            [](const Edge<V> & a, const Edge<V> & b) { return a.weight > b.weight; });
+            }
+            search.last_edge.assign(initial_state.num_of_vertices, -1);
+            for (int e = 0; e < edges_size; e++) {
+                search.last_edge[search.edges[e].u] = e;
+                search.last_edge[search.edges[e].v] = e;
+            }
+            countOpenDegrees(search);
+        }
+    }
+
+    void runSearch(int i) {
+        SolutionState<V> state = initial_state;
+        state.edges = searches[i].edges.data();
+        findBestStateDFS(searches[i], state);
+        // A search that was not stopped has searched its whole tree, nothing beats the best solution
+        if (!proved.exchange(true))
+            winner = i;
+    }
+
+    void search() {
+        initial_state.edges = this->edges;
+        if (initial_state.isBipartite() and initial_state.isConnected()) {
+            // Every edge is cut, the coloring of isBipartite is the best one
+            best_state = initial_state;
+            best_state.cost = best_state.edges_total_weight;
+            return;
+        }
+        initial_state.resetSolution();
+        best_state = initial_state;
+        int num_of_searches = number_of_threads > 0 ? number_of_threads : int(max(1u, thread::hardware_concurrency()));
+        initSearches(num_of_searches);
+        vector<thread> threads;
+        for (int i = 1; i < num_of_searches; i++)
+            threads.emplace_back(&ProblemInstance::runSearch, this, i);
+        runSearch(0);
+        for (auto & t : threads)
+            t.join();
+    }
+
+    SearchCounters totalCounters() const {
+        SearchCounters total;
+        for (auto & search : searches)
+            total += search.counters;
+        total.tasks = searches.size();
+        return total;
+    }
+
+    void printResult() {
+        auto end_time = chrono::high_resolution_clock::now();
+        cout << "============================================" << endl;
+        cout << "Result of: " << this->input_name << endl;
+        cout << "--------------------------------------------" << endl;
+        vector<int> reds;
+        vector<int> blues;
+        for (int i = 0; i < this->best_state.num_of_vertices; i++)
+            if (this->best_state.colors[i] == RED)
+                reds.push_back(i);
+            else
+                blues.push_back(i);
+        cout << "RED: {";
+        for (auto i = reds.begin(); i != reds.end(); i++) {
+            cout << int(*i);
+            if (i + 1 != reds.end()) cout << ", ";
+        }
+        cout << "}" << endl;
+        cout << "BLUE: {";
+        for (auto i = blues.begin(); i != blues.end(); i++) {
+            cout << int(*i);
+            if (i + 1 != blues.end()) cout << ", ";
+        }
+        cout << "}" << endl;
+        cout << "--------------------------------------------" << endl;
+        vector<Edge<V>> used_edges;
+        for (int i = 0; i < edges_size; i++)
+            if (best_state.colors[edges[i].u] != best_state.colors[edges[i].v])
+                used_edges.push_back(edges[i]);
+        cout << "EDGES: ";
+        for (auto i = used_edges.begin(); i != used_edges.end(); i++) {
+            cout << *i;
+            if (i+1 != used_edges.end()) cout << ", ";
+        }
+        cout << endl;
+        cout << "--------------------------------------------" << endl;
+        cout << "Weights sum = " << best_state.cost << endl;
+        cout << "--------------------------------------------" << endl;
+        if (winner >= 0) {
+            cout << "Proved by search " << winner << " of " << searches.size() << ", "
+                 << formatWithCommas(searches[winner].counters.nodes) << " of " << formatWithCommas(totalCounters().nodes)
+                 << " recursive calls" << endl;
+            cout << "--------------------------------------------" << endl;
+        }
+        if (print_stats)
+            totalCounters().printJson(chrono::duration<double>(end_time - start_time).count(), int(searches.size()));
+        cout << "Took: " << prettyPrintElapsedTime(start_time, end_time) << endl;
+        cout << "============================================" << endl;
+        printRecord(end_time);
+    }
+
+    void printRecord(time_point end_time) const {
+        if (output_format == "text")
+            return;
+        ResultRecord record;
+        record.backend = "portfolio";
+        record.input = input_name;
+        record.vertices = best_state.num_of_vertices;
+        record.edges = edges_size;
+        record.cost = best_state.cost;
+        for (int i = 0; i < best_state.num_of_vertices; i++)
+            (best_state.colors[i] == RED ? record.red : record.blue).push_back(i);
+        record.elapsed_us = chrono::duration_cast<chrono::microseconds>(end_time - start_time).count();
+        record.nodes = totalCounters().nodes;
+        record.threads = int(searches.size());
+        record.ranks = 1;
+        record.print(record_output);
+    }
+public:
+    ProblemInstance(string input_name, int num_of_vertices, const vector<InputEdge> & edges) {
+        // Inputs are dispatched by their size, so all the edges fit
+        for (edges_size = 0; size_t(edges_size) < min<size_t>(V::max_edges, edges.size()); edges_size++) {
+            this->edges[edges_size] = Edge<V>(edges[edges_size].u, edges[edges_size].v, edges[edges_size].weight);
+            this->initial_state.edges_total_weight += edges[edges_size].weight;
+        }
+        // Binary inputs are sorted already
+        if (!is_sorted(this->edges, this->edges + edges_size, greater<>()))
+            sort(this->edges, this->edges + edges_size, greater<>());
+        initial_state.num_of_vertices = num_of_vertices;
+        initial_state.edges_size = edges_size;
+        best_state = this->initial_state;
+
+        this->input_name = std::move(input_name);
+    }
+
+    string getInputName() override {
+        return input_name;
+    }
+
+    uint32_t getBestStateCost() const override {
+        return best_state.cost;
+    }
+
+    void findMaxConnectedBipartiteSubgraph() override {
+        start_time = chrono::high_resolution_clock::now();
+        search();
+        printResult();
+    }
+};
+
+class InputHandler {
+public:
+    static void printHelp() {
+        cout << "NI-PDP řešení úkolu pro sudé paralelky." << endl;
+        cout << "Bipartitní souvislý podgraf hranově ohodnoceného grafu s maximální vahou" << endl;
+        cout << "Portfolio několika různě uspořádaných prohledávání se sdíleným nejlepším řešením." << endl;
+        cout << "Každé je prohledávání po hranách sekvenční verze s vynucenými tahy a vyčíslením posledních vrcholů," << endl;
+        cout << "bez dynamického programování, Grayova kódu a rozkladu na bloky." << endl;
+        cout << "Parametry:" << endl;
+        cout << "   -h, --help                  Výpíše tuto zprávu." << endl;
+        cout << "   -t <num of threads>         Nastaví počet současných prohledávání. Defaultně jedno na jádro." << endl;
+        cout << "   --file <filepath>...        Spustí program pro soubory." << endl;
+        cout << "   --folder <folderpath>...    Spustí program pro složky." << endl;
+        cout << "   --leaf-vertices <k>         Každé prohledávání vyčíslí všechna dobarvení posledních k vrcholů. Defaultní hodnota je 10, 0 vypne." << endl;
+        cout << "   --seed <n>                  Semínko náhodného pořadí hran se stejnou vahou. Defaultní hodnota je 1." << endl;
+        cout << "   --stats                     Vypíše počítadla prohledávání (uzly, listy, ořezání, zlepšení, úlohy) jako JSON." << endl;
+        cout << "   --output <json|csv>         Vypíše výsledek každého vstupu jako záznam na standardní výstup, text jde na chybový výstup." << endl;
+        cout << "Parametry jsou vyhodnocvány v pořadí." << endl;
+        cout << "Jorge Zuňiga 2023" << endl;
+    }
+
+    // Reads the next integer, skips anything before it
+    static int scanInt(const char * & it, const char * end) {
+        while (it != end and (*it < '0' or *it > '9') and *it != '-')
+            it++;
+        bool negative = it != end and *it == '-';
+        if (negative)
+            it++;
+        int value = 0;
+        while (it != end and '0' <= *it and *it <= '9')
+            value = value * 10 + (*it++ - '0');
+        return negative ? -value : value;
+    }
+
+    // Skips the next number without converting it
+    static void skipInt(const char * & it, const char * end) {
+        while (it != end and *it <= ' ')
+            it++;
+        while (it != end and *it > ' ')
+            it++;
+    }
+
+    // Binary instance, the edges are already filtered and sorted, see converter/converter.cpp
+    static bool parseBinary(const char * it, const char * end, int & num_of_vertices, vector<InputEdge> & edges) {
+        // Vertices are stored as bytes, so binary instances always fit in Vertices150
+        using BinaryEdge = Edge<Vertices150>;
+        static_assert(sizeof(BinaryEdge) == 3, "Edges are stored as three bytes");
+        // The edge count is little endian whatever the host is
+        uint8_t n = uint8_t(it[4]);
+        uint16_t edges_size = uint16_t(uint8_t(it[5]) | uint8_t(it[6]) << 8);
+        const BinaryEdge * edges_begin = reinterpret_cast<const BinaryEdge *>(it + BINARY_HEADER_SIZE);
+        if (n > Vertices150::max_vertices or edges_size > Vertices150::max_edges or end - it < BINARY_HEADER_SIZE + edges_size * long(sizeof(BinaryEdge)))
+            return false;
+        num_of_vertices = n;
+        edges.reserve(edges_size);
+        for (const BinaryEdge * edge = edges_begin; edge != edges_begin + edges_size; edge++) {
+            // A malformed file would index past the vertices
+            if (edge->u >= n or edge->v >= n or edge->u == edge->v or edge->weight < MIN_WEIGHT or edge->weight > MAX_WEIGHT)
+                return false;
+            edges.emplace_back(edge->u, edge->v, edge->weight);
+        }
+        return true;
+    }
+
+    // The file is mapped into memory, only the upper triangle of the matrix is converted
+    static bool parseFile(const string & input_file_path, int & num_of_vertices, vector<InputEdge> & edges) {
+        int fd = open(input_file_path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) < 0 or file_stat.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        size_t size = file_stat.st_size;
+        void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        const char * it = static_cast<const char *>(data);
+        const char * end = it + size;
+        bool parsed = true;
+        if (size >= BINARY_HEADER_SIZE and memcmp(it, BINARY_MAGIC, 4) == 0) {
+            parsed = parseBinary(it, end, num_of_vertices, edges);
+        } else {
+            num_of_vertices = scanInt(it, end);
+            // Too large inputs are reported by the caller
+            if (num_of_vertices > Vertices1024::max_vertices)
+                num_of_vertices = -num_of_vertices;
+            edges.reserve(max(num_of_vertices, 0) * max(num_of_vertices - 1, 0) / 2);
+            for (int row = 0; row < num_of_vertices; row++) {
+                for (int column = 0; column <= row; column++)
+                    skipInt(it, end);
+                for (int column = row + 1; column < num_of_vertices; column++) {
+                    int weight = scanInt(it, end);
+                    if (MIN_WEIGHT <= weight and weight <= MAX_WEIGHT)
+                        edges.emplace_back(row, column, weight);
+                }
+            }
+        }
+        munmap(data, size);
+        return parsed;
+    }
+
+    // Every input is solved with the smallest vertex count class it fits in
+    static unique_ptr<Instance> makeInstance(const string & input_file_path, int num_of_vertices, const vector<InputEdge> & edges) {
+        if (num_of_vertices <= Vertices64::max_vertices)
+            return make_unique<ProblemInstance<Vertices64>>(input_file_path, num_of_vertices, edges);
+        if (num_of_vertices <= Vertices150::max_vertices)
+            return make_unique<ProblemInstance<Vertices150>>(input_file_path, num_of_vertices, edges);
+        return make_unique<ProblemInstance<Vertices1024>>(input_file_path, num_of_vertices, edges);
+    }
+
+    static vector<unique_ptr<Instance>> readFromFiles(const vector<string> & input_file_paths) {
+        vector<int> nums_of_vertices(input_file_paths.size(), 0);
+        vector<vector<InputEdge>> edges(input_file_paths.size());
+        vector<char> parsed(input_file_paths.size(), false);
+        // Files are taken from a shared counter, the results keep the input order
+        atomic<size_t> next_file{0};
+        auto parseFiles = [&]() {
+            for (size_t i = next_file++; i < input_file_paths.size(); i = next_file++)
+                parsed[i] = parseFile(input_file_paths[i], nums_of_vertices[i], edges[i]);
+        };
+        size_t num_of_threads = min<size_t>(max(1u, thread::hardware_concurrency()), input_file_paths.size());
+        vector<thread> threads;
+        for (size_t i = 1; i < num_of_threads; i++)
+            threads.emplace_back(parseFiles);
+        parseFiles();
+        for (auto & t : threads)
+            t.join();
+        vector<unique_ptr<Instance>> inputs;
+        for (size_t i = 0; i < input_file_paths.size(); i++) {
+            cout << "Loaded file " << input_file_paths[i] << endl;
+            if (!fs::exists(fs::path(input_file_paths[i])))
+                cout << "File \"" << input_file_paths[i] << "\' does not exist." << endl;
+            else if (!parsed[i])
+                cout << "Error opening " << input_file_paths[i] << endl;
+            else if (nums_of_vertices[i] < 0)
+                cout << "Too many vertices in " << input_file_paths[i] << ", at most " << Vertices1024::max_vertices << " are supported." << endl;
+            else
+                inputs.push_back(makeInstance(input_file_paths[i], nums_of_vertices[i], edges[i]));
+        }
+        return inputs;
+    }
+
+    static vector<unique_ptr<Instance>> readFromFile(const string & input_file_path) {
+        return readFromFiles({input_file_path});
+    }
+
+    static vector<unique_ptr<Instance>> readFromFolder(const string & input_folder_path) {
+        vector<unique_ptr<Instance>> inputs;
+        cout << "Loaded folder " << input_folder_path << endl;
+        if ( ! fs::is_directory(fs::path(input_folder_path))) {
+            cout << "Folder \"" << input_folder_path << "\" does not exist" << endl;
+            return inputs;
+        }
+        vector<string> paths_to_files;
+        for (const auto & entry : fs::directory_iterator(input_folder_path)) {
+            paths_to_files.push_back(entry.path());
+        }
+        sort(paths_to_files.begin(), paths_to_files.end());
+        return readFromFiles(paths_to_files);
+    }
+
+    static vector<unique_ptr<Instance>> readInput(int argc, char* argv[]) {
+        vector<unique_ptr<Instance>> inputs;
+        vector<string> args(argv + 1, argv+argc);
+        // Find flags -h, --help, --file <filepath>..., --folder <folderpath>..., -t <int>
+        bool help_arg_found_short = find(args.begin(), args.end(), "-h") != args.end();
+        bool help_arg_found_long = find(args.begin(), args.end(), "--help") != args.end();
+        auto file_arg_it = find(args.begin(), args.end(), "--file");
+        bool file_arg_found = file_arg_it != args.end();
+        auto folder_arg_it = find(args.begin(), args.end(), "--folder");
+        bool folder_arg_found = folder_arg_it != args.end();
+        auto thread_num_arg_it = find(args.begin(), args.end(), "-t");
+        bool thread_num_arg_found = thread_num_arg_it != args.end();
+        bool any_found = (help_arg_found_short or help_arg_found_long or file_arg_found or folder_arg_found or thread_num_arg_found);
+        // If -h, --help or none of the accepted flags found. Print out the help message.
+        if (help_arg_found_short or help_arg_found_long or !any_found) {
+            InputHandler::printHelp();
+            return inputs;
+        }
+        // If --output json|csv is found, print a record per instance and move the text to the standard error
+        auto output_arg_it = find(args.begin(), args.end(), "--output");
+        if (output_arg_it != args.end() and next(output_arg_it) != args.end()) {
+            output_format = *next(output_arg_it);
+            if (output_format == "json" or output_format == "csv") {
+                cout.rdbuf(cerr.rdbuf());
+            } else {
+                cout << "Unknown output format " << output_format << endl;
+                output_format = "text";
+            }
+        }
+        // If --seed <n> is found, break the ties of the edge orders with it
+        auto seed_arg_it = find(args.begin(), args.end(), "--seed");
+        if (seed_arg_it != args.end() and next(seed_arg_it) != args.end()) {
+            istringstream iss(*next(seed_arg_it));
+            iss >> seed;
+        }
+        // If --leaf-vertices <k> is found, enumerate the completions of the last k uncolored vertices, 0 = off
+        auto leaf_vertices_arg_it = find(args.begin(), args.end(), "--leaf-vertices");
+        if (leaf_vertices_arg_it != args.end() and next(leaf_vertices_arg_it) != args.end()) {
+            istringstream iss(*next(leaf_vertices_arg_it));
+            iss >> leaf_vertices;
+            leaf_vertices = clamp(leaf_vertices, 0, LEAF_MAX_VERTICES);
+        }
+        // If --stats is found, print the search counters of every instance as JSON
+        if (find(args.begin(), args.end(), "--stats") != args.end())
+            print_stats = true;
+        // If -t <int> is found, set the number of threads variable
+        if (thread_num_arg_found) {
+            auto num_of_threads_it = next(thread_num_arg_it);
+            if (num_of_threads_it != args.end()) {
+                istringstream iss(*num_of_threads_it);
+                iss >> number_of_threads;
+            }
+            cout << "Number of threads: " << number_of_threads << endl;
+        }
+        // If --file <filepath>... is present, extract from files
+        if (file_arg_found) {
+            auto input_files_it = next(file_arg_it);
+            vector<string> input_file_paths;
+            while (input_files_it != args.end() and !input_files_it->empty() and input_files_it->front() != '-') {
+                input_file_paths.push_back(*input_files_it);
+                input_files_it = next(input_files_it);
+            }
+            vector<unique_ptr<Instance>> file_inputs = InputHandler::readFromFiles(input_file_paths);
+            inputs.insert(inputs.end(), make_move_iterator(file_inputs.begin()), make_move_iterator(file_inputs.end()));
+        }
+        // If --folder <folderpath>... is present, extract from folders
+        if (folder_arg_found) {
+            auto input_folders_it = next(folder_arg_it);
+            while (input_folders_it != args.end() and !input_folders_it->empty() and input_folders_it->front() != '-') {
+                vector<unique_ptr<Instance>> folder_inputs = InputHandler::readFromFolder(*input_folders_it);
+                inputs.insert(inputs.end(), make_move_iterator(folder_inputs.begin()), make_move_iterator(folder_inputs.end()));
+                input_folders_it = next(input_folders_it);
+            }
+        }
+        return inputs;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    // Read input
+    auto start_time_load = chrono::high_resolution_clock::now();
+    vector<unique_ptr<Instance>> inputs = InputHandler::readInput(argc, argv);
+    auto end_time_load = chrono::high_resolution_clock::now();
+    // Measure time
+    auto start_time_total = chrono::high_resolution_clock::now();
+    // Find solutions
+    for (auto & problem_instance : inputs)
+        problem_instance->findMaxConnectedBipartiteSubgraph();
+    // End of time measure
+    auto end_time_total = chrono::high_resolution_clock::now();
+    // Print load time, total time if more than one result
+    if (!inputs.empty()) {
+        cout << "============================================" << endl;
+        cout << "Load time: " << prettyPrintElapsedTime(start_time_load, end_time_load) << endl;
+        if (inputs.size() > 1)
+            cout << "Total time: " << prettyPrintElapsedTime(start_time_total, end_time_total) << endl;
+        cout << "============================================" << endl;
+    }
+    // Assert
+    unordered_map<string, uint32_t> results = {
+        // Easy
+        {"graf_10_3.txt", 1300},
+        {"graf_10_5.txt", 1885},
+        {"graf_10_6.txt", 2000},
+        {"graf_10_7.txt", 2348},
+        {"graf_12_3.txt", 1422},
+        {"graf_12_5.txt", 2219},
+        {"graf_12_6.txt", 2533},
+        {"graf_12_9.txt", 3437},
+        {"graf_13_9.txt", 3700},
+        {"graf_13_12.txt", 4182},
+        {"graf_15_4.txt", 2547},
+        {"graf_15_5.txt", 2892},
+        {"graf_15_6.txt", 3353},
+        {"graf_15_8.txt", 3984},
+        {"graf_15_12.txt", 5380},
+        {"graf_15_14.txt", 5578},
+        {"graf_17_10.txt", 5415},
+        // Medium
+        {"graf_20_16.txt", 9353},
+        {"graf_20_17.txt", 9768},
+        {"graf_20_19.txt", 10288},
+        {"graf_21_15.txt", 9570},
+        {"graf_22_17.txt", 11015},
+        {"graf_23_20.txt", 12902},
+        {"graf_24_23.txt", 14844},
+        // Hard
+        {"graf_25_16.txt", 12105},
+        {"graf_25_22.txt", 15594},
+        {"graf_26_25.txt", 17477},
+        {"graf_27_19.txt", 15470},
+        {"graf_28_24.txt", 18729},
+        {"graf_29_26.txt", 20810},
+        {"graf_30_25.txt", 21336}
+    };
+    // Print if wrong result
+    for (auto & problem_instance : inputs) {
+        // Binary inputs share the name of the text input
+        string name = fs::path(problem_instance->getInputName()).stem().string() + ".txt";
+        if (results.count(name) > 0) {
+            uint32_t expected = results[name];
+            uint32_t got = problem_instance->getBestStateCost();
+            if (got != expected)
+                cout << problem_instance->getInputName() << " expected: " << expected << " got: " << got << endl;
+        }
+    }
+    return 0;
+}
@@ -6,31 +6,134 @@
 #include <iostream>
 #include <utility>
 #include <vector>
+#include <memory>
 #include <string>
 #include <filesystem>
 #include <chrono>
+#include <iomanip>
 #include <algorithm>
 #include <fstream>
 #include <unordered_map>
 #include <queue>
+#include <set>
+#include <array>
+#include <random>
+#include <numeric>
+#include <cmath>
+#include <limits>
 #include <cstdint>
 #include <cstring>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-#define MAX_VERTICES 150
-#define MAX_EDGES 11175 // 150 choose 2
 #define MAX_WEIGHT 120
 #define MIN_WEIGHT 80
+#define BINARY_MAGIC "PDPG" // Instances made by the converter
+#define BINARY_HEADER_SIZE 11
+// Number of open states the search is split into when checkpointing
+#define FRONTIER_SIZE 1024
+// Largest graph searched with the packed colors, 2 bits per vertex in one uint64_t
+#define PACKED_MAX_VERTICES 32
+// Largest graph enumerated by the Gray code engine, one bit per vertex in uint32_t
+#define GRAY_MAX_VERTICES 32
+// Largest graph the auto engine enumerates, bigger ones are searched by the edges
+#define GRAY_AUTO_VERTICES 20
+// Instances solved at once by the batch search, one per vector lane, and the largest of them
+#define BATCH_LANES 16
+#define BATCH_MAX_VERTICES 20
+// Most uncolored vertices whose colorings are all enumerated at the bottom of the edge search
+#define LEAF_MAX_VERTICES 16
+// Seconds between two exchanges of the best cost with the bound file of the split jobs
+#define BOUND_SYNC_SECONDS 1
+// The dynamic programming runs only if its tables have at most 2^(n - DP_SEARCH_MARGIN) cells, the denser graphs are
+// searched faster. A cell takes about 5 bytes, the tables of one graph get at most DP_MAX_MIB.
+#define DP_SEARCH_MARGIN 4
+#define DP_MAX_MIB 1024
 
 using namespace std;
 namespace fs = std::filesystem;
 using time_point = chrono::high_resolution_clock::time_point;
 
+// Checkpointing
+string checkpoint_path;
+int checkpoint_interval = 60; // seconds
+bool resume = false;
+
+// Anytime mode
+int time_limit = 0; // seconds, 0 = no limit
+time_point deadline;
+bool time_is_up = false;
+
+// Preprocessing
+bool preprocess = true; // Split the graph into biconnected blocks
+int max_dp_width = 22; // Largest tree decomposition width solved by dynamic programming, 0 = off
+
+// Transposition table
+size_t tt_memory = 0; // MiB, 0 = off
+
+// Russian doll search, the bound of the remaining edges is the maximum cut of the edge suffix instead of its weight
+bool russian_doll = false;
+
+// Branching of the search, edge decides one edge per level, vertex colors one vertex per level, gray enumerates all
+// colorings, auto enumerates the small graphs and searches the others by the edges
+string engine = "auto";
+bool max_cut_first = false; // Search the maximum cut first and the connected ones only if it is not connected
+bool batch = false; // Solve the small instances BATCH_LANES at a time
+int leaf_vertices = 10; // The edge search enumerates the completions once at most this many vertices are uncolored
+
+// Root split, job i of 2^k searches the colorings that start with the bits of i on the highest degree vertices
+int split_bits = 0; // 0 = off
+int split_job = 0;
+string bound_path; // Best cost found by the jobs so far
+
+// Statistics
+bool print_stats = false; // Print the search counters as JSON
+int progress_interval = 0; // Seconds between the progress reports, 0 = off
+string progress_path; // Status file with the last progress report, standard error if empty
+int estimate_probes = 0; // Only estimate the size of the edge search by this many random probes, 0 = off
+
+// Machine readable output, the records go to the standard output and the text to the standard error
+string output_format = "text"; // text, json or csv
+ostream record_output(cout.rdbuf());
+
 enum color_t : uint8_t {NO_COLOR, RED, BLUE};
 
-class Edge;
-class SolutionState;
-class ProblemInstance;
+// Vertex count classes, every input is solved with the smallest one it fits in
+struct Vertices64 {
+    static constexpr int max_vertices = 64;
+    static constexpr int max_edges = 2016; // 64 choose 2
+    using vertex_t = uint8_t;
+    using edge_index_t = uint16_t;
+};
+
+struct Vertices150 {
+    static constexpr int max_vertices = 150;
+    static constexpr int max_edges = 11175; // 150 choose 2
+    using vertex_t = uint8_t;
+    using edge_index_t = uint16_t;
+};
+
+struct Vertices1024 {
+    static constexpr int max_vertices = 1024;
+    static constexpr int max_edges = 523776; // 1024 choose 2
+    using vertex_t = uint16_t;
+    using edge_index_t = int32_t;
+};
+
+template <typename V> class Edge;
+template <typename V> class SolutionState;
+template <typename V> class Checkpoint;
+template <typename V, int N> class PackedSearch;
+class Instance;
+template <typename V> class ProblemInstance;
 class InputHandler;
+struct ProblemInstanceAccess; // Microbenchmarks of the private parts, see microbench/microbench.cpp
 
 string prettyPrintElapsedTime(time_point start_time, time_point end_time) {
     auto ms = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
@@ -41,7 +144,7 @@ string prettyPrintElapsedTime(time_point start_time, time_point end_time) {
     auto s = chrono::duration_cast<chrono::seconds>(ms);
     ms -= chrono::duration_cast<chrono::milliseconds>(s);
     ostringstream oss;
-    oss << h.count() << "h:" << m.count() << "m:" << s.count() << "." << ms.count() << "s";
+    oss << h.count() << "h:" << m.count() << "m:" << s.count() << "." << setw(3) << setfill('0') << ms.count() << "s";
     return oss.str();
 }
 
@@ -61,10 +164,232 @@ string formatWithCommas(uint64_t number) {
     return formatted;
 }
 
+// Result of one instance for --output json or csv
+struct ResultRecord {
+    string backend;
+    string input;
+    int vertices = 0;
+    int edges = 0;
+    uint32_t cost = 0;
+    vector<int> red;
+    vector<int> blue;
+    int64_t elapsed_us = 0;
+    uint64_t nodes = 0;
+    int threads = 1;
+    int ranks = 1;
+
+    static string joined(const vector<int> & vertices, const string & separator) {
+        ostringstream oss;
+        for (size_t i = 0; i < vertices.size(); i++)
+            oss << (i > 0 ? separator : "") << vertices[i];
+        return oss.str();
+    }
+
+    static string quoted(const string & text) {
+        string escaped = "\"";
+        for (char c : text) {
+            if (c == '"' or c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped + "\"";
+    }
+
+    void print(ostream & out) const {
+        if (output_format == "json") {
+            out << "{\"backend\": " << quoted(backend) << ", \"input\": " << quoted(input)
+                << ", \"vertices\": " << vertices << ", \"edges\": " << edges << ", \"cost\": " << cost
+                << ", \"red\": [" << joined(red, ", ") << "], \"blue\": [" << joined(blue, ", ") << "]"
+                << ", \"elapsed_us\": " << elapsed_us << ", \"nodes\": " << nodes
+                << ", \"threads\": " << threads << ", \"ranks\": " << ranks << "}" << endl;
+        } else if (output_format == "csv") {
+            static bool header_printed = false;
+            if (!header_printed) {
+                out << "backend,input,vertices,edges,cost,red,blue,elapsed_us,nodes,threads,ranks" << endl;
+                header_printed = true;
+            }
+            // CSV quotes are doubled, not escaped
+            string input_field = input;
+            for (size_t i = 0; (i = input_field.find('"', i)) != string::npos; i += 2)
+                input_field.insert(i, 1, '"');
+            out << backend << ",\"" << input_field << "\"," << vertices << "," << edges << "," << cost << ","
+                << joined(red, " ") << "," << joined(blue, " ") << "," << elapsed_us << "," << nodes << ","
+                << threads << "," << ranks << endl;
+        }
+    }
+};
+
+bool timeIsUp() {
+    static uint32_t calls = 0;
+    // Reading the clock on every call would slow down the search
+    if (time_limit > 0 and !time_is_up and (++calls & 1023) == 0)
+        time_is_up = chrono::high_resolution_clock::now() >= deadline;
+    return time_is_up;
+}
+
+// Progress of the running search, read by the progress reporter from its own thread. The searches publish their nodes
+// in batches and their improvements with relaxed atomic stores, the reporter never reads the fields they work on.
+struct SearchProgress {
+    static constexpr uint64_t NODES_BATCH = 1024;
+    atomic<uint64_t> nodes{0};
+    atomic<uint32_t> best_cost{0};
+    atomic<bool> costs_of_graph{true}; // False while a part of the graph is searched, its costs are not the graph's
+
+    void reset() {
+        nodes.store(0, memory_order_relaxed);
+        best_cost.store(0, memory_order_relaxed);
+        costs_of_graph.store(true, memory_order_relaxed);
+    }
+
+    // Keeps the largest cost, the threads may publish their costs out of order
+    void improve(uint32_t cost) {
+        uint32_t best = best_cost.load(memory_order_relaxed);
+        while (costs_of_graph.load(memory_order_relaxed) and cost > best
+               and !best_cost.compare_exchange_weak(best, cost, memory_order_relaxed)) {
+        }
+    }
+
+    // Hides the costs of a part of the graph until restore, returns the previous state for it
+    bool hideCosts() {
+        return costs_of_graph.exchange(false, memory_order_relaxed);
+    }
+
+    void restore(bool previous) {
+        costs_of_graph.store(previous, memory_order_relaxed);
+    }
+};
+SearchProgress search_progress;
+
+// Search counters of one thread. Every thread counts into its own cache line, so the threads do not slow each
+// other down, and the counters are summed after the search.
+struct alignas(64) SearchCounters {
+    uint64_t nodes = 0;
+    uint64_t leaves = 0;
+    uint64_t weight_prunes = 0;     // The remaining weight cannot beat the best cost
+    uint64_t edge_count_prunes = 0; // Too few remaining edges to connect all vertices
+    uint64_t forced_prunes = 0;     // A vertex without a cut edge has no remaining edge that can be one
+    uint64_t forced_moves = 0;      // A vertex was colored by the only remaining edge of its neighbour
+    uint64_t improvements = 0;
+    uint64_t tasks = 0;
+
+    SearchCounters & operator += (const SearchCounters & other) {
+        nodes += other.nodes;
+        leaves += other.leaves;
+        weight_prunes += other.weight_prunes;
+        edge_count_prunes += other.edge_count_prunes;
+        forced_prunes += other.forced_prunes;
+        forced_moves += other.forced_moves;
+        improvements += other.improvements;
+        tasks += other.tasks;
+        return *this;
+    }
+
+    // Counts a node, every NODES_BATCH nodes of the counters are published to the progress reporter
+    void countNode() {
+        if (++nodes % SearchProgress::NODES_BATCH == 0)
+            search_progress.nodes.fetch_add(SearchProgress::NODES_BATCH, memory_order_relaxed);
+    }
+
+    void countImprovement(uint32_t cost) {
+        improvements++;
+        search_progress.improve(cost);
+    }
+
+    void printJson(double seconds, int threads) const {
+        cout << "{\"nodes\": " << nodes
+             << ", \"nodes_per_second\": " << uint64_t(seconds > 0 ? double(nodes) / seconds : 0.0)
+             << ", \"leaves\": " << leaves
+             << ", \"weight_prunes\": " << weight_prunes
+             << ", \"edge_count_prunes\": " << edge_count_prunes
+             << ", \"forced_prunes\": " << forced_prunes
+             << ", \"forced_moves\": " << forced_moves
+             << ", \"improvements\": " << improvements
+             << ", \"tasks\": " << tasks
+             << ", \"threads\": " << threads << "}" << endl;
+    }
+};
+
+// Numbers of a running search read by the progress reporter
+struct ProgressSample {
+    uint64_t nodes = 0;
+    uint32_t best_cost = 0;
+    size_t units_done = 0;  // Finished states of the frontier
+    size_t units_total = 0; // 0 if the search has no frontier
+};
+
+// Writes the progress of a running search every progress_interval seconds from its own thread. The search never
+// waits for it, the reports are read from search_progress, so a report is a snapshot that may be a moment old.
+class ProgressReporter {
+private:
+    string input_name;
+    function<ProgressSample()> sample;
+    time_point start_time;
+    atomic<bool> stopping{false};
+    thread reporter;
+
+    void report(uint64_t & last_nodes, time_point & last_time) {
+        ProgressSample progress = sample();
+        auto now = chrono::high_resolution_clock::now();
+        double interval = chrono::duration<double>(now - last_time).count();
+        uint64_t new_nodes = progress.nodes > last_nodes ? progress.nodes - last_nodes : 0;
+        last_nodes = progress.nodes;
+        last_time = now;
+        ostringstream oss;
+        oss << "Progress of " << input_name << ": " << prettyPrintElapsedTime(start_time, now)
+            << ", nodes " << formatWithCommas(progress.nodes)
+            << " (" << formatWithCommas(interval > 0 ? uint64_t(double(new_nodes) / interval) : 0) << "/s)"
+            << ", best " << progress.best_cost;
+        // The units of the frontier are about the same size, the rest takes as long per unit as the done ones
+        if (progress.units_total > 0) {
+            double done = double(progress.units_done) / double(progress.units_total);
+            oss << ", frontier " << progress.units_done << "/" << progress.units_total
+                << " (" << fixed << setprecision(1) << 100.0 * done << " %)";
+            if (progress.units_done > 0) {
+                auto remaining = chrono::duration<double>(now - start_time) * ((1.0 - done) / done);
+                oss << ", ETA " << prettyPrintElapsedTime(now, now + chrono::duration_cast<time_point::duration>(remaining));
+            }
+        }
+        if (progress_path.empty()) {
+            cerr << oss.str() << endl;
+            return;
+        }
+        // The status file always holds a whole report
+        string temporary_path = progress_path + ".tmp";
+        {
+            ofstream status_file(temporary_path, ios::trunc);
+            status_file << oss.str() << endl;
+        }
+        error_code error;
+        fs::rename(temporary_path, progress_path, error);
+    }
+public:
+    ProgressReporter(const string & input_name, function<ProgressSample()> sample)
+        : input_name(input_name), sample(move(sample)), start_time(chrono::high_resolution_clock::now()) {
+        reporter = thread([this] {
+            uint64_t last_nodes = 0;
+            time_point last_time = start_time;
+            time_point next_report = start_time + chrono::seconds(progress_interval);
+            while (!stopping.load()) {
+                this_thread::sleep_for(chrono::milliseconds(100));
+                if (chrono::high_resolution_clock::now() < next_report)
+                    continue;
+                report(last_nodes, last_time);
+                next_report += chrono::seconds(progress_interval);
+            }
+        });
+    }
+
+    ~ProgressReporter() {
+        stopping = true;
+        reporter.join();
+    }
+};
+
+template <typename V>
 class Edge {
 public:
-    uint8_t u; // < 150
-    uint8_t v; // < 150
+    typename V::vertex_t u;
+    typename V::vertex_t v;
     uint8_t weight; // 80 <= weight <= 120
 public:
     Edge() {
@@ -95,16 +420,20 @@ public:
     }
 };
 
+// Edges as read from the input, before the instance size is known
+using InputEdge = Edge<Vertices1024>;
+
+template <typename V>
 class SolutionState {
 public:
-    color_t colors[MAX_VERTICES] = {NO_COLOR};
-    uint8_t num_of_vertices = 0; // < 150
-    uint16_t edge_index = 0; // < 11175
-    uint16_t used_edges = 0; // < 11175
+    color_t colors[V::max_vertices] = {NO_COLOR};
+    typename V::vertex_t num_of_vertices = 0;
+    typename V::edge_index_t edge_index = 0;
+    typename V::edge_index_t used_edges = 0;
     uint32_t cost = 0;
     uint32_t sum_cost_all = 0;
-    Edge * edges = nullptr;
-    uint16_t edges_size = 0; // < 11175
+    Edge<V> * edges = nullptr;
+    typename V::edge_index_t edges_size = 0;
     uint32_t edges_total_weight = 0;
 public:
     void resetSolution() {
@@ -149,88 +478,1166 @@ public:
                 }
             }
         }
-        return true;
+        return true;
+    }
+
+    // Union-find with path halving, an adjacency matrix would not fit on the stack for larger graphs
+    static int findRoot(typename V::vertex_t (& parent)[V::max_vertices], int v) {
+        while (parent[v] != v) {
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
+    }
+
+    bool isConnected() const {
+        typename V::vertex_t parent[V::max_vertices];
+        for (int i = 0; i < num_of_vertices; i++)
+            parent[i] = i;
+        int components = num_of_vertices;
+        for (int i = 0; i < edges_size; i++) {
+            int root_u = findRoot(parent, edges[i].u);
+            int root_v = findRoot(parent, edges[i].v);
+            if (root_u != root_v) {
+                parent[root_u] = root_v;
+                components--;
+            }
+        }
+        return components <= 1;
+    }
+
+    // The edges between the color classes have to connect all vertices
+    bool isCutConnected() const {
+        typename V::vertex_t parent[V::max_vertices];
+        for (int i = 0; i < num_of_vertices; i++)
+            parent[i] = i;
+        int components = num_of_vertices;
+        for (int i = 0; i < edges_size; i++) {
+            if (colors[edges[i].u] == NO_COLOR or colors[edges[i].u] == colors[edges[i].v])
+                continue;
+            int root_u = findRoot(parent, edges[i].u);
+            int root_v = findRoot(parent, edges[i].v);
+            if (root_u != root_v) {
+                parent[root_u] = root_v;
+                components--;
+            }
+        }
+        return components <= 1;
+    }
+
+    uint32_t sumWeightRemainingEdges() const {
+        return edges_total_weight - sum_cost_all;
+    }
+
+    int numOfUsedEdges() const {
+        return int(used_edges);
+    }
+
+    int numOfRemainingEdges() const {
+        return edges_size - edge_index;
+    }
+
+    static color_t getOppositeColor(color_t c) {
+        return (c == RED) ? BLUE : RED;
+    }
+
+    void skipEdge() {
+        sum_cost_all += edges[edge_index].weight;
+        edge_index++;
+    }
+
+    void addEdge() {
+        sum_cost_all += edges[edge_index].weight;
+        cost += edges[edge_index].weight;
+        edge_index++;
+        used_edges++;
+    }
+};
+
+template <typename V>
+class Checkpoint {
+    // Binary layout (native byte order):
+    //   "PDPC", name length (u16), input name, num_of_vertices (u16), edges_size (u32),
+    //   best state, number of frontier states (u32), frontier states.
+    // A state is edge_index (u32), used_edges (u32), cost (u32), sum_cost_all (u32)
+    // and the colors packed 4 per byte.
+private:
+    template<typename T>
+    static void write(ofstream & out, T value) {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    static T read(ifstream & in) {
+        T value{};
+        in.read(reinterpret_cast<char *>(&value), sizeof(value));
+        return value;
+    }
+
+    static void writeState(ofstream & out, const SolutionState<V> & state) {
+        write(out, uint32_t(state.edge_index));
+        write(out, uint32_t(state.used_edges));
+        write(out, state.cost);
+        write(out, state.sum_cost_all);
+        for (int i = 0; i < state.num_of_vertices; i += 4) {
+            uint8_t packed = 0;
+            for (int j = 0; j < 4 and i + j < state.num_of_vertices; j++)
+                packed |= state.colors[i + j] << (2 * j);
+            write(out, packed);
+        }
+    }
+
+    // False if the state cannot belong to the instance, the file is corrupt
+    static bool readState(ifstream & in, SolutionState<V> & state, uint32_t edges_size) {
+        uint32_t edge_index = read<uint32_t>(in);
+        uint32_t used_edges = read<uint32_t>(in);
+        if (edge_index > edges_size or used_edges > edge_index)
+            return false;
+        state.edge_index = edge_index;
+        state.used_edges = used_edges;
+        state.cost = read<uint32_t>(in);
+        state.sum_cost_all = read<uint32_t>(in);
+        for (int i = 0; i < state.num_of_vertices; i += 4) {
+            auto packed = read<uint8_t>(in);
+            for (int j = 0; j < 4 and i + j < state.num_of_vertices; j++) {
+                state.colors[i + j] = color_t((packed >> (2 * j)) & 3);
+                if (state.colors[i + j] > BLUE)
+                    return false;
+            }
+        }
+        return bool(in);
+    }
+public:
+    static void save(const string & path, const string & input_name, const SolutionState<V> & best_state, const vector<SolutionState<V>> & frontier) {
+        string tmp_path = path + ".tmp";
+        ofstream out(tmp_path, ios::binary | ios::trunc);
+        if (!out.is_open()) {
+            cout << "Error writing checkpoint " << path << endl;
+            return;
+        }
+        string name = fs::path(input_name).filename();
+        out.write("PDPC", 4);
+        write(out, uint16_t(name.size()));
+        out.write(name.data(), streamsize(name.size()));
+        write(out, uint16_t(best_state.num_of_vertices));
+        write(out, uint32_t(best_state.edges_size));
+        writeState(out, best_state);
+        write(out, uint32_t(frontier.size()));
+        for (const auto & state : frontier)
+            writeState(out, state);
+        out.close();
+        // Replace the previous checkpoint only once the new one is complete
+        fs::rename(tmp_path, path);
+    }
+
+    // States are read on top of initial_state, so they share its graph. Nothing is changed unless the whole file is valid.
+    static bool load(const string & path, const string & input_name, const SolutionState<V> & initial_state, SolutionState<V> & best_state, vector<SolutionState<V>> & frontier) {
+        ifstream in(path, ios::binary);
+        if (!in.is_open())
+            return false;
+        char magic[4];
+        in.read(magic, 4);
+        if (!in or memcmp(magic, "PDPC", 4) != 0)
+            return false;
+        string name(read<uint16_t>(in), '\0');
+        in.read(&name[0], streamsize(name.size()));
+        if (name != string(fs::path(input_name).filename()))
+            return false;
+        uint16_t num_of_vertices = read<uint16_t>(in);
+        uint32_t edges_size = read<uint32_t>(in);
+        if (num_of_vertices != initial_state.num_of_vertices or edges_size != uint32_t(initial_state.edges_size))
+            return false;
+        SolutionState<V> loaded_best_state = initial_state;
+        if (!readState(in, loaded_best_state, edges_size))
+            return false;
+        // The number of states has to match the rest of the file, so a truncated file is not read past its end
+        uint32_t frontier_size = read<uint32_t>(in);
+        streamoff state_bytes = streamoff(4 * sizeof(uint32_t) + (num_of_vertices + 3) / 4);
+        streamoff position = in.tellg();
+        in.seekg(0, ios::end);
+        streamoff remaining = in.tellg() - position;
+        in.seekg(position);
+        if (!in or remaining != streamoff(frontier_size) * state_bytes)
+            return false;
+        vector<SolutionState<V>> loaded_frontier(frontier_size, initial_state);
+        for (auto & state : loaded_frontier)
+            if (!readState(in, state, edges_size))
+                return false;
+        best_state = loaded_best_state;
+        frontier = std::move(loaded_frontier);
+        return true;
+    }
+};
+
+// Search specialized for graphs of exactly N vertices. The colors of all vertices are packed into one
+// word and the remaining weight comes from a table, so the whole state is 16 bytes and is passed in
+// registers. The branching is the same as in ProblemInstance.
+template <typename V, int N>
+class PackedSearch {
+    static_assert(N <= PACKED_MAX_VERTICES, "Two bits per vertex have to fit in 64 bits");
+    static constexpr int max_edges = N * (N - 1) / 2;
+private:
+    struct State {
+        uint64_t colors = 0; // color_t of vertex i in bits 2i and 2i + 1
+        uint32_t cost = 0;
+        uint16_t edge_index = 0;
+        uint16_t used_edges = 0;
+    };
+    static_assert(sizeof(State) == 16, "State has to fit in two registers");
+    const Edge<V> * edges;
+    const int edges_size;
+    const bool connected;
+    uint32_t remaining_weight[max_edges + 1]; // Sum of the weights of edges from index i to the end
+    State best_state;
+    SearchCounters counters;
+private:
+    static color_t color(State state, int v) {
+        return color_t((state.colors >> (2 * v)) & 3);
+    }
+
+    static State colored(State state, int v, color_t c) {
+        state.colors |= uint64_t(c) << (2 * v);
+        return state;
+    }
+
+    void findBestStateDFS(State state) {
+        counters.countNode();
+        if (state.edge_index == edges_size) {
+            counters.leaves++;
+            // The leaf check of SolutionState looks at the whole graph, so it is the same for every leaf
+            if (connected and state.cost > best_state.cost) {
+                best_state = state;
+                counters.countImprovement(state.cost);
+            }
+            return;
+        }
+        if (state.cost + remaining_weight[state.edge_index] < best_state.cost) {
+            counters.weight_prunes++;
+            return;
+        }
+        if (state.used_edges + edges_size - state.edge_index < N - 1) {
+            counters.edge_count_prunes++;
+            return;
+        }
+        int u = edges[state.edge_index].u;
+        int v = edges[state.edge_index].v;
+        color_t color_u = color(state, u);
+        color_t color_v = color(state, v);
+        State skip = state;
+        skip.edge_index++;
+        State add = skip;
+        add.cost += edges[state.edge_index].weight;
+        add.used_edges++;
+        if (color_u != NO_COLOR and color_u == color_v) {
+            findBestStateDFS(skip);
+        } else if (color_u == NO_COLOR and color_v == NO_COLOR) {
+            findBestStateDFS(colored(colored(add, u, RED), v, BLUE));
+            findBestStateDFS(colored(colored(add, u, BLUE), v, RED));
+            findBestStateDFS(colored(colored(skip, u, RED), v, RED));
+            findBestStateDFS(colored(colored(skip, u, BLUE), v, BLUE));
+        } else if (color_v == NO_COLOR) {
+            findBestStateDFS(colored(add, v, SolutionState<V>::getOppositeColor(color_u)));
+            findBestStateDFS(colored(skip, v, color_u));
+        } else if (color_u == NO_COLOR) {
+            findBestStateDFS(colored(add, u, SolutionState<V>::getOppositeColor(color_v)));
+            findBestStateDFS(colored(skip, u, color_v));
+        } else {
+            findBestStateDFS(add);
+        }
+    }
+
+    PackedSearch(const Edge<V> * edges, int edges_size, bool connected)
+        : edges(edges), edges_size(edges_size), connected(connected) {
+        remaining_weight[edges_size] = 0;
+        for (int i = edges_size - 1; i >= 0; i--)
+            remaining_weight[i] = remaining_weight[i + 1] + edges[i].weight;
+    }
+public:
+    // Searches from the coloring of initial_state, the result is written to best_state only if it is better
+    static void run(const SolutionState<V> & initial_state, SolutionState<V> & best_state, SearchCounters & counters) {
+        PackedSearch search(initial_state.edges, initial_state.edges_size, initial_state.isConnected());
+        State start;
+        for (int i = 0; i < N; i++)
+            start = colored(start, i, initial_state.colors[i]);
+        search.best_state.cost = best_state.cost;
+        search.findBestStateDFS(start);
+        counters += search.counters;
+        if (search.best_state.cost <= best_state.cost)
+            return;
+        best_state = initial_state;
+        for (int i = 0; i < N; i++)
+            best_state.colors[i] = color(search.best_state, i);
+        best_state.cost = search.best_state.cost;
+        best_state.sum_cost_all = initial_state.edges_total_weight;
+        best_state.edge_index = search.best_state.edge_index;
+        best_state.used_edges = search.best_state.used_edges;
+    }
+};
+
+template <typename V>
+using PackedSearchFn = void (*)(const SolutionState<V> &, SolutionState<V> &, SearchCounters &);
+
+// Dispatch table, entry n is the search specialized for n vertices
+template <typename V, int... N>
+constexpr array<PackedSearchFn<V>, sizeof...(N)> makePackedSearchTable(integer_sequence<int, N...>) {
+    return {{&PackedSearch<V, N>::run...}};
+}
+
+// Search that colors one vertex per level instead of deciding one edge per level. With positive weights every edge
+// between the color classes is taken, so a coloring is a solution and the tree is n levels deep instead of m. The
+// gains of an uncolored vertex are the weights of its edges to the colored vertices of the other color, they are
+// updated when a neighbour is colored. The bound adds the larger gain of every uncolored vertex and the weight of
+// the edges between the uncolored vertices to the cost.
+template <typename V>
+class VertexSearch {
+private:
+    const int num_of_vertices;
+    const bool connected;
+    vector<vector<pair<int, uint32_t>>> adjacency;
+    vector<int> order; // Uncolored vertices of the initial state, each one the most connected to the ones before it
+    vector<color_t> colors;
+    vector<uint32_t> gain_red;
+    vector<uint32_t> gain_blue;
+    uint32_t cost = 0;
+    uint32_t max_gains_sum = 0; // Sum of max(gain_red, gain_blue) over the uncolored vertices
+    uint32_t uncolored_weight = 0; // Weight of the edges between two uncolored vertices
+    vector<color_t> best_colors;
+    uint32_t best_cost = 0;
+    SearchCounters counters;
+private:
+    void color(int v, color_t c) {
+        max_gains_sum -= max(gain_red[v], gain_blue[v]);
+        cost += c == RED ? gain_red[v] : gain_blue[v];
+        colors[v] = c;
+        for (auto [w, weight] : adjacency[v]) {
+            if (colors[w] != NO_COLOR)
+                continue;
+            uncolored_weight -= weight;
+            max_gains_sum -= max(gain_red[w], gain_blue[w]);
+            (c == RED ? gain_blue[w] : gain_red[w]) += weight;
+            max_gains_sum += max(gain_red[w], gain_blue[w]);
+        }
+    }
+
+    void uncolor(int v) {
+        color_t c = colors[v];
+        for (auto [w, weight] : adjacency[v]) {
+            if (colors[w] != NO_COLOR)
+                continue;
+            uncolored_weight += weight;
+            max_gains_sum -= max(gain_red[w], gain_blue[w]);
+            (c == RED ? gain_blue[w] : gain_red[w]) -= weight;
+            max_gains_sum += max(gain_red[w], gain_blue[w]);
+        }
+        colors[v] = NO_COLOR;
+        cost -= c == RED ? gain_red[v] : gain_blue[v];
+        max_gains_sum += max(gain_red[v], gain_blue[v]);
+    }
+
+    void findBestStateDFS(size_t level) {
+        counters.countNode();
+        if (level == order.size()) {
+            counters.leaves++;
+            // Same leaf check as SolutionState, the maximum cut of a connected graph is connected
+            if (connected and cost > best_cost) {
+                best_colors = colors;
+                best_cost = cost;
+                counters.countImprovement(cost);
+            }
+            return;
+        }
+        // Only a strictly better coloring is kept
+        if (cost + max_gains_sum + uncolored_weight <= best_cost) {
+            counters.weight_prunes++;
+            return;
+        }
+        int v = order[level];
+        color_t first = gain_red[v] >= gain_blue[v] ? RED : BLUE;
+        for (color_t c : {first, SolutionState<V>::getOppositeColor(first)}) {
+            color(v, c);
+            findBestStateDFS(level + 1);
+            uncolor(v);
+        }
+    }
+
+    VertexSearch(const SolutionState<V> & initial_state, bool check_connected)
+        : num_of_vertices(initial_state.num_of_vertices), connected(!check_connected or initial_state.isConnected()),
+          adjacency(num_of_vertices), colors(num_of_vertices, NO_COLOR), gain_red(num_of_vertices, 0),
+          gain_blue(num_of_vertices, 0) {
+        for (int i = 0; i < initial_state.edges_size; i++) {
+            const Edge<V> & edge = initial_state.edges[i];
+            adjacency[edge.u].emplace_back(edge.v, edge.weight);
+            adjacency[edge.v].emplace_back(edge.u, edge.weight);
+            uncolored_weight += edge.weight;
+        }
+        for (int i = 0; i < num_of_vertices; i++)
+            if (initial_state.colors[i] != NO_COLOR)
+                color(i, initial_state.colors[i]);
+        // Maximum adjacency order from the highest degree vertex, the gains of the next vertex are as large as possible
+        vector<uint32_t> connection(num_of_vertices, 0);
+        vector<char> ordered(num_of_vertices, false);
+        for (int i = 0; i < num_of_vertices; i++) {
+            if (colors[i] != NO_COLOR) {
+                ordered[i] = true;
+                for (auto [w, weight] : adjacency[i])
+                    connection[w] += weight;
+            }
+        }
+        size_t uncolored = count(colors.begin(), colors.end(), NO_COLOR);
+        while (order.size() < uncolored) {
+            int next = -1;
+            for (int i = 0; i < num_of_vertices; i++) {
+                if (ordered[i])
+                    continue;
+                if (next < 0 or connection[i] > connection[next] or
+                    (connection[i] == connection[next] and adjacency[i].size() > adjacency[next].size()))
+                    next = i;
+            }
+            ordered[next] = true;
+            order.push_back(next);
+            for (auto [w, weight] : adjacency[next])
+                connection[w] += weight;
+        }
+    }
+public:
+    // Searches from the coloring of initial_state, the result is written to best_state only if it is better.
+    // Without check_connected it is the maximum cut of any graph.
+    static void run(const SolutionState<V> & initial_state, SolutionState<V> & best_state, SearchCounters & counters,
+                    bool check_connected = true) {
+        VertexSearch search(initial_state, check_connected);
+        search.best_cost = best_state.cost;
+        // Swapping the colors gives the same cut, so the first vertex is red unless the coloring is fixed already
+        bool precolored = search.order.size() < size_t(search.num_of_vertices);
+        if (!search.order.empty() and !precolored) {
+            search.color(search.order[0], RED);
+            search.findBestStateDFS(1);
+        } else {
+            search.findBestStateDFS(0);
+        }
+        counters += search.counters;
+        if (search.best_cost <= best_state.cost)
+            return;
+        best_state = initial_state;
+        for (int i = 0; i < search.num_of_vertices; i++)
+            best_state.colors[i] = search.best_colors[i];
+        best_state.cost = 0;
+        best_state.used_edges = 0;
+        for (int i = 0; i < initial_state.edges_size; i++) {
+            const Edge<V> & edge = initial_state.edges[i];
+            if (best_state.colors[edge.u] != best_state.colors[edge.v]) {
+                best_state.cost += edge.weight;
+                best_state.used_edges++;
+            }
+        }
+        best_state.edge_index = initial_state.edges_size;
+        best_state.sum_cost_all = initial_state.edges_total_weight;
+    }
+};
+
+// Exhaustive search of all colorings in Gray code order. Consecutive colorings differ in one vertex, so the cost is
+// updated by the edges of that vertex only and the connectivity of the cut is checked only when the cost beats the
+// best one. Vertex i is blue if bit i of the coloring is set, the last vertex stays red, swapping the colors gives the
+// same cut. The colorings are split by their highest bits into prefixes, each prefix is enumerated on its own.
+template <typename V>
+class GraySearch {
+public:
+    struct Result {
+        uint32_t colors = 0;
+        uint32_t cost = 0;
+        SearchCounters counters;
+    };
+private:
+    int num_of_vertices;
+    uint32_t all_vertices;
+    uint32_t neighbours[GRAY_MAX_VERTICES] = {0};
+    vector<pair<int, uint32_t>> adjacency[GRAY_MAX_VERTICES];
+private:
+    uint32_t cutCost(uint32_t colors) const {
+        uint32_t cost = 0;
+        for (int v = 0; v < num_of_vertices; v++)
+            for (auto [w, weight] : adjacency[v])
+                if (v < w and ((colors >> v) ^ (colors >> w)) & 1)
+                    cost += weight;
+        return cost;
+    }
+
+    // Breadth-first search over the edges between the color classes, the frontier is a bit set
+    bool isCutConnected(uint32_t colors) const {
+        uint32_t reached = 1;
+        uint32_t frontier = 1;
+        while (frontier != 0) {
+            int v = __builtin_ctz(frontier);
+            frontier &= frontier - 1;
+            uint32_t other_color = (colors >> v) & 1 ? ~colors : colors;
+            uint32_t next = neighbours[v] & other_color & ~reached;
+            reached |= next;
+            frontier |= next;
+        }
+        return reached == all_vertices;
+    }
+public:
+    explicit GraySearch(const SolutionState<V> & initial_state) : num_of_vertices(initial_state.num_of_vertices) {
+        all_vertices = num_of_vertices == 32 ? ~0u : (1u << num_of_vertices) - 1;
+        for (int i = 0; i < initial_state.edges_size; i++) {
+            const Edge<V> & edge = initial_state.edges[i];
+            neighbours[edge.u] |= 1u << edge.v;
+            neighbours[edge.v] |= 1u << edge.u;
+            adjacency[edge.u].emplace_back(edge.v, edge.weight);
+            adjacency[edge.v].emplace_back(edge.u, edge.weight);
+        }
+    }
+
+    // Enumerates the colorings whose vertices from n - 1 - prefix_bits to n - 2 have the bits of the prefix,
+    // only a coloring better than best_cost is returned
+    Result searchPrefix(uint32_t prefix, int prefix_bits, uint32_t best_cost) const {
+        Result result;
+        result.cost = best_cost;
+        int free_bits = num_of_vertices - 1 - prefix_bits;
+        uint32_t colors = prefix << free_bits;
+        uint32_t cost = cutCost(colors);
+        for (uint64_t i = 0; i < uint64_t(1) << free_bits; i++) {
+            if (i > 0) {
+                int v = __builtin_ctzll(i);
+                uint32_t color_v = (colors >> v) & 1;
+                for (auto [w, weight] : adjacency[v]) {
+                    if (((colors >> w) & 1) == color_v)
+                        cost += weight;
+                    else
+                        cost -= weight;
+                }
+                colors ^= 1u << v;
+            }
+            result.counters.countNode();
+            if (cost > result.cost) {
+                result.counters.leaves++;
+                if (isCutConnected(colors)) {
+                    result.colors = colors;
+                    result.cost = cost;
+                    result.counters.countImprovement(cost);
+                }
+            }
+        }
+        return result;
+    }
+};
+
+// Lock-free transposition table with replacement by depth. An entry is two words, the first one is the key xor the
+// data, so an entry torn by a concurrent write fails the key check instead of returning wrong data.
+class TranspositionTable {
+private:
+    struct Entry {
+        atomic<uint64_t> check{0};
+        atomic<uint64_t> data{0};
+    };
+    // Data of an entry: gain bound (32 bits) | used edges (20 bits) | depth (12 bits)
+    static constexpr int DEPTH_BITS = 12;
+    static constexpr int USED_EDGES_BITS = 20;
+    unique_ptr<Entry[]> entries;
+    uint64_t mask;
+    atomic<uint64_t> probes{0};
+    atomic<uint64_t> hits{0};
+
+    static uint64_t pack(uint32_t gain, uint32_t used_edges, uint32_t depth) {
+        return uint64_t(gain) << (USED_EDGES_BITS + DEPTH_BITS) | uint64_t(used_edges) << DEPTH_BITS | min(depth, (1u << DEPTH_BITS) - 1);
+    }
+public:
+    explicit TranspositionTable(size_t memory_mib) {
+        size_t size = 1;
+        while (size * 2 * sizeof(Entry) <= memory_mib << 20)
+            size *= 2;
+        entries = make_unique<Entry[]>(size);
+        mask = size - 1;
+    }
+
+    // True if a searched state with the same key proves that the state cannot beat the best cost. The bound of a
+    // state with more used edges holds for fewer, it was pruned by the vertex count less.
+    bool cutsOff(uint64_t key, uint32_t used_edges, uint32_t cost, uint32_t best_cost) {
+        probes.fetch_add(1, memory_order_relaxed);
+        Entry & entry = entries[key & mask];
+        uint64_t data = entry.data.load(memory_order_relaxed);
+        if ((entry.check.load(memory_order_relaxed) ^ data) != key)
+            return false;
+        uint32_t entry_used_edges = (data >> DEPTH_BITS) & ((1u << USED_EDGES_BITS) - 1);
+        uint32_t gain = uint32_t(data >> (USED_EDGES_BITS + DEPTH_BITS));
+        if (used_edges > entry_used_edges or cost + gain > best_cost)
+            return false;
+        hits.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    // Keeps the bound of the state searched deeper, depth is the number of remaining edges
+    void store(uint64_t key, uint32_t depth, uint32_t used_edges, uint32_t gain) {
+        Entry & entry = entries[key & mask];
+        uint64_t old_data = entry.data.load(memory_order_relaxed);
+        uint64_t old_key = entry.check.load(memory_order_relaxed) ^ old_data;
+        if (old_key != key and old_data != 0 and (old_data & ((1u << DEPTH_BITS) - 1)) > min(depth, (1u << DEPTH_BITS) - 1))
+            return;
+        uint64_t data = pack(gain, used_edges, depth);
+        entry.check.store(key ^ data, memory_order_relaxed);
+        entry.data.store(data, memory_order_relaxed);
+    }
+
+    uint64_t getProbes() const {
+        return probes.load();
+    }
+
+    uint64_t getHits() const {
+        return hits.load();
+    }
+};
+
+// Interface of the instances of all sizes
+class Instance {
+public:
+    virtual ~Instance() = default;
+    virtual string getInputName() = 0;
+    virtual uint32_t getBestStateCost() const = 0;
+    virtual void findMaxConnectedBipartiteSubgraph() = 0;
+    virtual int getNumOfVertices() const = 0;
+    virtual vector<InputEdge> getEdges() const = 0;
+    // Takes the maximum cut found by the batch search, returns false if it is not connected
+    virtual bool acceptBatchColoring(const vector<color_t> & colors, time_point batch_start_time) = 0;
+};
+
+template <typename V>
+class ProblemInstance : public Instance {
+    template <typename W> friend class ProblemInstance;
+    friend struct ProblemInstanceAccess;
+private:
+    Edge<V> edges[V::max_edges];
+    typename V::edge_index_t edges_size;
+    SolutionState<V> initial_state;
+    SolutionState<V> best_state;
+    // Checkpointing
+    vector<SolutionState<V>> solution_states_queue;
+    atomic<size_t> units_done{0}; // Searched states of the frontier, for the progress reports
+    atomic<size_t> units_total{0};
+    time_point last_checkpoint_time;
+    // Anytime mode
+    uint32_t open_bound = 0; // Best cost the states left open by the time limit can reach
+    vector<uint32_t> triangle_bound; // Upper bound of the cut of the edges from i to the end, see initTriangleBounds
+    // Root split
+    uint32_t shared_bound = 0; // Read from the bound file, the job looks for solutions at least this good
+    time_point next_bound_sync;
+    bool is_block = false; // Searched as a part of a larger instance, see findBestStateByBlocks
+    // Max-cut-first mode
+    uint32_t max_cut_bound = UINT32_MAX; // Cost of the disconnected maximum cut, no connected one is better
+    // Transposition table, the key of a state is its edge index and the colors of the vertices with remaining edges
+    unique_ptr<TranspositionTable> transposition_table;
+    vector<uint64_t> zobrist_vertices; // Two keys per vertex, one for each color
+    vector<uint64_t> zobrist_edges;
+    vector<int> last_edge; // Index of the last edge of every vertex
+    // Forced moves, remaining edges of the vertices without a cut edge on the current branch of findBestStateDFS, the
+    // ones with a cut edge are covered. Kept here instead of in every state, a branch updates the endpoints of its
+    // last edge and restores them when it returns.
+    typename V::vertex_t open_degrees[V::max_vertices] = {};
+    static constexpr typename V::vertex_t COVERED = numeric_limits<typename V::vertex_t>::max();
+    // Russian doll search, suffix_bound[i] is the maximum cut of the edges from i to the end
+    vector<uint32_t> suffix_bound;
+    // Metrics
+    string input_name;
+    SearchCounters counters;
+    time_point start_time;
+private:
+    bool noBetterSolutionPossible(SolutionState<V> state) {
+        uint32_t remaining_bound = suffix_bound.empty() ? state.sumWeightRemainingEdges() : suffix_bound[state.edge_index];
+        if (state.cost + remaining_bound < best_state.cost or best_state.cost >= max_cut_bound) {
+            counters.weight_prunes++;
+            return true;
+        }
+        if (state.numOfUsedEdges() + state.numOfRemainingEdges() < int(state.num_of_vertices - 1)) {
+            counters.edge_count_prunes++;
+            return true;
+        }
+        return false;
+    }
+
+    // Totals of the probes of the estimate
+    struct EstimateProbes {
+        uint64_t nodes = 0;
+        uint64_t enumerations = 0; // Nodes that enumerated their last vertices
+        double enumeration_seconds = 0;
+        double estimated_enumerations = 0; // Sum of the estimates of all probes
+    };
+
+    // Children of the state in the order of findBestStateDFS, returns their number
+    int branchStates(const SolutionState<V> & state, SolutionState<V> * children) const {
+        int u = edges[state.edge_index].u;
+        int v = edges[state.edge_index].v;
+        int num_of_children = 0;
+        for (auto [color_u, color_v] : {pair{RED, BLUE}, pair{BLUE, RED}, pair{RED, RED}, pair{BLUE, BLUE}}) {
+            if ((state.colors[u] != NO_COLOR and state.colors[u] != color_u) or
+                (state.colors[v] != NO_COLOR and state.colors[v] != color_v))
+                continue;
+            SolutionState<V> & child = children[num_of_children++];
+            child = state;
+            if (color_u != color_v)
+                child.addEdge();
+            else
+                child.skipEdge();
+            child.colors[u] = color_u;
+            child.colors[v] = color_v;
+        }
+        return num_of_children;
+    }
+
+    // The first leaf of findBestStateDFS, so the estimate prunes with the first bound of the real search
+    void diveFirstBranches(SolutionState<V> state) {
+        SolutionState<V> children[4];
+        while (!state.isLeaf()) {
+            if (noBetterSolutionPossible(state))
+                return;
+            branchStates(state, children);
+            state = children[0];
+        }
+        if (state.isConnected() and state.isBetterThan(best_state))
+            best_state = state;
+    }
+
+    // Knuth's estimate, a random path down the tree counts every level as the product of the branching factors above
+    // it. The path is pruned like findBestStateDFS prunes, the leaves on the way raise the bound like they do in the
+    // search. A node that enumerates its last vertices ends the path, it is counted apart because it takes longer.
+    double probeSubtreeSize(SolutionState<V> state, mt19937_64 & generator, EstimateProbes & probes) {
+        SolutionState<V> children[4];
+        double level_size = 1;
+        double size = 1;
+        // The path never returns, so the degrees are not restored on the way
+        countOpenDegrees(state);
+        while (true) {
+            probes.nodes++;
+            if (state.isLeaf()) {
+                if (state.isConnected() and state.isBetterThan(best_state))
+                    best_state = state;
+                return size;
+            }
+            if (noBetterSolutionPossible(state))
+                return size;
+            addLastDecidedEdge(open_degrees, edges, state);
+            if (!propagateForcedMoves(state))
+                return size;
+            if (leaf_vertices > 0) {
+                int uncolored[V::max_vertices];
+                int k = 0;
+                for (int i = 0; i < state.num_of_vertices; i++)
+                    if (state.colors[i] == NO_COLOR)
+                        uncolored[k++] = i;
+                if (k <= leaf_vertices) {
+                    auto enumeration_start = chrono::high_resolution_clock::now();
+                    findBestStateLeaves(state, uncolored, k);
+                    probes.enumeration_seconds += chrono::duration<double>(chrono::high_resolution_clock::now() - enumeration_start).count();
+                    probes.enumerations++;
+                    probes.estimated_enumerations += level_size;
+                    return size;
+                }
+            }
+            int num_of_children = branchStates(state, children);
+            level_size *= num_of_children;
+            size += level_size;
+            state = children[uniform_int_distribution<int>(0, num_of_children - 1)(generator)];
+        }
+    }
+
+    // Only the edge search is estimated, the dispatches before it in search() are left out
+    void printEstimatedSearch() const {
+        cout << "Estimated search: by edges, " << (suffix_bound.empty() ? "weight" : "suffix") << " bounds, forced moves, ";
+        if (leaf_vertices > 0)
+            cout << "enumeration of the last " << leaf_vertices << " vertices" << endl;
+        else
+            cout << "no enumeration of the last vertices" << endl;
+        cout << "Not estimated: the tree decomposition DP, the Gray code and vertex engines, the packed search and the"
+             << " split into blocks, the run may solve the instance by them" << endl;
+    }
+
+    void printEstimate() {
+        initial_state.edges = this->edges;
+        initial_state.resetSolution();
+        initLastEdges();
+        // The suffix bounds are computed like in the search, their nodes and time are measured instead of estimated
+        auto suffix_bounds_start = chrono::high_resolution_clock::now();
+        if (russian_doll)
+            initSuffixBounds();
+        double suffix_bounds_nodes = double(counters.nodes);
+        double suffix_bounds_seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - suffix_bounds_start).count();
+        diveFirstBranches(initial_state);
+        uint32_t first_bound = best_state.cost;
+        mt19937_64 generator(0x5eed);
+        EstimateProbes probes;
+        double sum = 0;
+        double sum_of_squares = 0;
+        double sum_of_enumerations = 0;
+        auto probes_start = chrono::high_resolution_clock::now();
+        for (int i = 0; i < estimate_probes; i++) {
+            double estimated_enumerations = probes.estimated_enumerations;
+            double size = probeSubtreeSize(initial_state, generator, probes);
+            sum += size;
+            sum_of_squares += size * size;
+            sum_of_enumerations += probes.estimated_enumerations - estimated_enumerations;
+        }
+        auto probes_end = chrono::high_resolution_clock::now();
+        double mean = sum / estimate_probes;
+        double variance = max(0.0, sum_of_squares / estimate_probes - mean * mean);
+        double mean_enumerations = sum_of_enumerations / estimate_probes;
+        // A probe visits a node about as fast as the search does, the enumerations are timed apart
+        double seconds = chrono::duration<double>(probes_end - probes_start).count();
+        double seconds_per_node = max(seconds - probes.enumeration_seconds, 0.0) / double(max<uint64_t>(probes.nodes, 1));
+        double seconds_per_enumeration = probes.enumeration_seconds / double(max<uint64_t>(probes.enumerations, 1));
+        double estimated_seconds = suffix_bounds_seconds + mean * seconds_per_node + mean_enumerations * seconds_per_enumeration;
+        auto estimated_time = chrono::duration_cast<time_point::duration>(chrono::duration<double>(estimated_seconds));
+        cout << "============================================" << endl;
+        cout << "Estimate of: " << this->input_name << endl;
+        cout << "--------------------------------------------" << endl;
+        printEstimatedSearch();
+        cout << "Probes: " << formatWithCommas(estimate_probes) << ", first bound = " << first_bound << endl;
+        if (russian_doll)
+            cout << "Suffix bounds: " << formatWithCommas(uint64_t(suffix_bounds_nodes)) << " nodes, measured" << endl;
+        cout << "Estimated nodes: " << formatWithCommas(uint64_t(suffix_bounds_nodes + mean)) << " (standard error " << fixed << setprecision(1)
+             << 100.0 * sqrt(variance / estimate_probes) / max(mean, 1.0) << " %)";
+        cout.unsetf(ios::floatfield);
+        if (leaf_vertices > 0)
+            cout << ", " << formatWithCommas(uint64_t(mean_enumerations)) << " of them enumerate the last vertices";
+        cout << endl;
+        cout << "Estimated time: " << prettyPrintElapsedTime(probes_start, probes_start + estimated_time) << endl;
+        cout << "============================================" << endl;
+    }
+
+    void generateStatesQueue() {
+        this->solution_states_queue.push_back(initial_state);
+        while (!solution_states_queue.empty() and solution_states_queue.size() < FRONTIER_SIZE) {
+            findBestStateBFS(solution_states_queue.front());
+            solution_states_queue.erase(solution_states_queue.begin());
+        }
+    }
+
+    void findBestStateBFS(SolutionState<V> state) {
+        // Check if better solution found
+        if (state.isLeaf()) {
+            counters.leaves++;
+            if (state.isConnected() and state.isBetterThan(best_state)) {
+                best_state = state;
+                counters.countImprovement(state.cost);
+                if (time_limit > 0)
+                    printImprovement();
+                return;
+            } else {
+                return;
+            }
+        }
+        // Cut the tree of solutions
+        if (noBetterSolutionPossible(state))
+            return;
+        // Color the graph to keep bipartity.
+        int u = edges[state.edge_index].u;
+        int v = edges[state.edge_index].v;
+        if ((state.colors[u] == RED and state.colors[v] == RED) or
+            (state.colors[u] == BLUE and state.colors[v] == BLUE)){
+            {
+                SolutionState<V> opt_skip = state;
+                opt_skip.skipEdge();
+                solution_states_queue.push_back(opt_skip);
+            }
+        } else if (state.colors[u] == NO_COLOR and state.colors[v] == NO_COLOR) {
+            {
+                SolutionState<V> opt_add_red_blue = state;
+                opt_add_red_blue.addEdge();
+                opt_add_red_blue.colors[u] = RED;
+                opt_add_red_blue.colors[v] = BLUE;
+                solution_states_queue.push_back(opt_add_red_blue);
+            }
+            {
+                SolutionState<V> opt_add_blue_red = state;
+                opt_add_blue_red.addEdge();
+                opt_add_blue_red.colors[u] = BLUE;
+                opt_add_blue_red.colors[v] = RED;
+                solution_states_queue.push_back(opt_add_blue_red);
+            }
+            {
+                SolutionState<V> opt_skip_red_red = state;
+                opt_skip_red_red.skipEdge();
+                opt_skip_red_red.colors[u] = RED;
+                opt_skip_red_red.colors[v] = RED;
+                solution_states_queue.push_back(opt_skip_red_red);
+            }
+            {
+                SolutionState<V> opt_skip_blue_blue = state;
+                opt_skip_blue_blue.skipEdge();
+                opt_skip_blue_blue.colors[u] = BLUE;
+                opt_skip_blue_blue.colors[v] = BLUE;
+                solution_states_queue.push_back(opt_skip_blue_blue);
+            }
+        } else if ((state.colors[u] == RED and state.colors[v] == NO_COLOR) or
+                   (state.colors[u] == BLUE and state.colors[v] == NO_COLOR)) {
+            {
+                SolutionState<V> opt_add_opposite = state;
+                opt_add_opposite.addEdge();
+                opt_add_opposite.colors[v] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[u]);
+                solution_states_queue.push_back(opt_add_opposite);
+            }
+            {
+                SolutionState<V> opt_skip_same = state;
+                opt_skip_same.skipEdge();
+                opt_skip_same.colors[v] = opt_skip_same.colors[u];
+                solution_states_queue.push_back(opt_skip_same);
+            }
+        } else if ((state.colors[u] == NO_COLOR and state.colors[v] == RED) or
+                   (state.colors[u] == NO_COLOR and state.colors[v] == BLUE)) {
+            {
+                SolutionState<V> opt_add_opposite = state;
+                opt_add_opposite.addEdge();
+                opt_add_opposite.colors[u] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[v]);
+                solution_states_queue.push_back(opt_add_opposite);
+            }
+            {
+                SolutionState<V> opt_skip_same = state;
+                opt_skip_same.skipEdge();
+                opt_skip_same.colors[u] = opt_skip_same.colors[v];
+                solution_states_queue.push_back(opt_skip_same);
+            }
+        } else if ((state.colors[u] == RED and state.colors[v] == BLUE) or
+                   (state.colors[u] == BLUE and state.colors[v] == RED)) {
+            {
+                SolutionState<V> opt_add = state;
+                opt_add.addEdge();
+                solution_states_queue.push_back(opt_add);
+            }
+        }
     }
 
-    void isConnectedDFS(const uint8_t (& adj_map)[MAX_VERTICES][MAX_VERTICES], const uint8_t (& adj_map_sizes)[MAX_VERTICES], uint8_t v, bool (& visited)[MAX_VERTICES]) {
-        visited[v] = true;
-        for (int i = 0; i < adj_map_sizes[v]; i++)
-            if (!visited[adj_map[v][i]])
-                isConnectedDFS(adj_map, adj_map_sizes, adj_map[v][i], visited);
+    // Russian doll search over the edge suffixes, from the shortest one. A cut of a suffix is a cut of the longer one,
+    // so the optimum of the shorter suffix is where the search of the longer one starts. The suffixes are solved by
+    // the vertex engine without the connectivity, so the bounds are admissible.
+    void initSuffixBounds() {
+        bool costs_of_graph = search_progress.hideCosts();
+        suffix_bound.assign(edges_size + 1, 0);
+        uint32_t suffix_weight = 0;
+        for (int i = edges_size - 1; i >= 0; i--) {
+            suffix_weight += edges[i].weight;
+            SolutionState<V> suffix = initial_state;
+            suffix.resetSolution();
+            suffix.edges = this->edges + i;
+            suffix.edges_size = edges_size - i;
+            suffix.edges_total_weight = suffix_weight;
+            SolutionState<V> suffix_cut = suffix;
+            suffix_cut.cost = suffix_bound[i + 1] > 0 ? suffix_bound[i + 1] - 1 : 0;
+            VertexSearch<V>::run(suffix, suffix_cut, counters, false);
+            suffix_bound[i] = max(suffix_cut.cost, suffix_bound[i + 1]);
+        }
+        search_progress.restore(costs_of_graph);
     }
 
-    bool isConnected() {
-        uint8_t adj_map[MAX_VERTICES][MAX_VERTICES] = {{0}};
-        uint8_t adj_map_sizes[MAX_VERTICES] = {0};
-        for (int i = 0; i < edges_size; i++) {
-            adj_map[edges[i].u][adj_map_sizes[edges[i].u]] = edges[i].v;
-            adj_map_sizes[edges[i].u]++;
-            adj_map[edges[i].v][adj_map_sizes[edges[i].v]] = edges[i].u;
-            adj_map_sizes[edges[i].v]++;
-        }
-        bool visited[MAX_VERTICES] = {false};
-        isConnectedDFS(adj_map, adj_map_sizes, 0, visited);
-        for (int i = 0; i < num_of_vertices; ++i)
-            if (!visited[i])
-                return false;
-        return true;
+    void initTranspositionTable() {
+        int n = initial_state.num_of_vertices;
+        transposition_table = make_unique<TranspositionTable>(tt_memory);
+        mt19937_64 generator(0x5eed);
+        zobrist_vertices.resize(2 * n);
+        zobrist_edges.resize(edges_size + 1);
+        for (auto & key : zobrist_vertices)
+            key = generator();
+        for (auto & key : zobrist_edges)
+            key = generator() | 1;
     }
 
-    uint32_t sumWeightRemainingEdges() const {
-        return edges_total_weight - sum_cost_all;
+    void initLastEdges() {
+        last_edge.assign(initial_state.num_of_vertices, -1);
+        for (int i = 0; i < edges_size; i++) {
+            last_edge[edges[i].u] = i;
+            last_edge[edges[i].v] = i;
+        }
     }
 
-    int numOfUsedEdges() const {
-        return int(used_edges);
+    // The forced moves color vertices ahead of their edges, so both colors of the vertices with remaining edges are hashed
+    uint64_t transpositionKey(const SolutionState<V> & state) const {
+        uint64_t key = zobrist_edges[state.edge_index];
+        for (int i = 0; i < state.num_of_vertices; i++)
+            if (state.colors[i] != NO_COLOR and last_edge[i] >= int(state.edge_index))
+                key ^= zobrist_vertices[2 * i + (state.colors[i] == BLUE)];
+        return key;
     }
 
-    int numOfRemainingEdges() const {
-        return edges_size - edge_index;
+    // After the whole subtree is searched, no state in it beats the best cost
+    void storeTransposition(uint64_t key, const SolutionState<V> & state) {
+        uint32_t best_cost = best_state.cost;
+        transposition_table->store(key, uint32_t(edges_size - state.edge_index), uint32_t(state.used_edges),
+                                   best_cost > state.cost ? best_cost - state.cost : 0);
     }
 
-    static color_t getOppositeColor(color_t c) {
-        return (c == RED) ? BLUE : RED;
+    // Bottom of the edge search, every uncolored vertex gets both colors at once. The cut edges of a completion are the
+    // remaining edges between different colors, so its cost is the cost of the state, the remaining edges between the
+    // colored vertices, the gains of the uncolored vertices from their colored neighbours and the edges between the
+    // uncolored vertices. The completions are walked in Gray code order, a flip updates the cost by one row.
+    void findBestStateLeaves(const SolutionState<V> & state, const int * uncolored, int k) {
+        int position[V::max_vertices];
+        for (int i = 0; i < k; i++)
+            position[uncolored[i]] = i;
+        int32_t base = int32_t(state.cost);
+        int32_t gain_red[LEAF_MAX_VERTICES] = {0};
+        int32_t gain_blue[LEAF_MAX_VERTICES] = {0};
+        int32_t weights[LEAF_MAX_VERTICES][LEAF_MAX_VERTICES] = {{0}};
+        for (int i = state.edge_index; i < edges_size; i++) {
+            color_t color_u = state.colors[edges[i].u];
+            color_t color_v = state.colors[edges[i].v];
+            int32_t weight = edges[i].weight;
+            if (color_u != NO_COLOR and color_v != NO_COLOR) {
+                base += color_u != color_v ? weight : 0;
+            } else if (color_u == NO_COLOR and color_v == NO_COLOR) {
+                weights[position[edges[i].u]][position[edges[i].v]] += weight;
+                weights[position[edges[i].v]][position[edges[i].u]] += weight;
+            } else {
+                int j = position[color_u == NO_COLOR ? edges[i].u : edges[i].v];
+                (color_u == BLUE or color_v == BLUE ? gain_red[j] : gain_blue[j]) += weight;
+            }
+        }
+        // All red first, bit i of the completion is set if vertex uncolored[i] is blue
+        int32_t cost = base;
+        for (int i = 0; i < k; i++)
+            cost += gain_red[i];
+        int32_t best_cost = cost;
+        uint32_t best_completion = 0;
+        uint32_t completion = 0;
+        for (uint32_t i = 1; i < 1u << k; i++) {
+            int v = __builtin_ctz(i);
+            int32_t bit_v = (completion >> v) & 1;
+            cost += bit_v ? gain_red[v] - gain_blue[v] : gain_blue[v] - gain_red[v];
+            for (int j = 0; j < k; j++)
+                cost += int32_t(((completion >> j) & 1) == uint32_t(bit_v)) * 2 * weights[v][j] - weights[v][j];
+            completion ^= 1u << v;
+            if (cost > best_cost) {
+                best_cost = cost;
+                best_completion = completion;
+            }
+        }
+        counters.leaves += 1u << k;
+        if (uint32_t(best_cost) <= best_state.cost or !state.isConnected())
+            return;
+        SolutionState<V> leaf = state;
+        for (int i = 0; i < k; i++)
+            leaf.colors[uncolored[i]] = (best_completion >> i) & 1 ? BLUE : RED;
+        while (!leaf.isLeaf()) {
+            if (leaf.colors[edges[leaf.edge_index].u] != leaf.colors[edges[leaf.edge_index].v])
+                leaf.addEdge();
+            else
+                leaf.skipEdge();
+        }
+        best_state = leaf;
+        counters.countImprovement(leaf.cost);
+        if (time_limit > 0)
+            printImprovement();
     }
 
-    void skipEdge() {
-        sum_cost_all += edges[edge_index].weight;
-        edge_index++;
+    // Degrees of the state before its last decided edge, findBestStateDFS adds that edge when it enters the state
+    void countOpenDegrees(const SolutionState<V> & state) {
+        int decided_edges = max(int(state.edge_index) - 1, 0);
+        fill(open_degrees, open_degrees + state.num_of_vertices, 0);
+        for (int i = decided_edges; i < edges_size; i++) {
+            open_degrees[edges[i].u]++;
+            open_degrees[edges[i].v]++;
+        }
+        for (int i = 0; i < state.num_of_vertices; i++)
+            if (open_degrees[i] == 0)
+                open_degrees[i] = COVERED;
+        for (int i = 0; i < decided_edges; i++) {
+            if (state.colors[edges[i].u] != state.colors[edges[i].v]) {
+                open_degrees[edges[i].u] = COVERED;
+                open_degrees[edges[i].v] = COVERED;
+            }
+        }
     }
 
-    void addEdge() {
-        sum_cost_all += edges[edge_index].weight;
-        cost += edges[edge_index].weight;
-        edge_index++;
-        used_edges++;
+    // A cut edge covers its endpoints, a skipped one takes one remaining edge from each of them
+    static void addLastDecidedEdge(typename V::vertex_t * open_degrees, const Edge<V> * edges, const SolutionState<V> & state) {
+        if (state.edge_index == 0)
+            return;
+        int u = edges[state.edge_index - 1].u;
+        int v = edges[state.edge_index - 1].v;
+        if (state.colors[u] != state.colors[v]) {
+            open_degrees[u] = COVERED;
+            open_degrees[v] = COVERED;
+        } else {
+            if (open_degrees[u] != COVERED)
+                open_degrees[u]--;
+            if (open_degrees[v] != COVERED)
+                open_degrees[v]--;
+        }
     }
-};
 
-class ProblemInstance {
-private:
-    Edge edges[MAX_EDGES];
-    uint16_t edges_size;
-    SolutionState initial_state;
-    SolutionState best_state;
-    // Metrics
-    string input_name;
-    uint64_t recursive_calls;
-    time_point start_time;
-private:
-    bool noBetterSolutionPossible(SolutionState state) const {
-        if (state.cost + state.sumWeightRemainingEdges() < best_state.cost)
+    // The last decided edge of a state in open_degrees for the time of its branch
+    class OpenDegreesScope {
+    private:
+        typename V::vertex_t * open_degrees;
+        int u = 0, v = 0;
+        typename V::vertex_t degree_u = 0, degree_v = 0;
+        bool active = false;
+    public:
+        OpenDegreesScope(typename V::vertex_t * open_degrees, const Edge<V> * edges, const SolutionState<V> & state)
+                : open_degrees(open_degrees) {
+            if (state.edge_index == 0)
+                return;
+            active = true;
+            u = edges[state.edge_index - 1].u;
+            v = edges[state.edge_index - 1].v;
+            degree_u = open_degrees[u];
+            degree_v = open_degrees[v];
+            addLastDecidedEdge(open_degrees, edges, state);
+        }
+
+        ~OpenDegreesScope() {
+            if (!active)
+                return;
+            open_degrees[u] = degree_u;
+            open_degrees[v] = degree_v;
+        }
+    };
+
+    // Every vertex needs a cut edge to be connected, the endpoints of the last skipped edge may have lost their last
+    // chance. A vertex with one remaining edge has to take it, so the other endpoint gets the opposite color, the edge
+    // is the last one of the vertex. Returns false if a vertex cannot get a cut edge any more.
+    bool propagateForcedMoves(SolutionState<V> & state) {
+        if (state.edge_index == 0)
             return true;
-        if (state.numOfUsedEdges() + state.numOfRemainingEdges() < int(state.num_of_vertices - 1))
+        const Edge<V> & edge = edges[state.edge_index - 1];
+        // Covered vertices and the ones with more remaining edges are the common case
+        if (open_degrees[edge.u] > 1 and open_degrees[edge.v] > 1)
             return true;
-        return false;
+        for (int vertex : {int(edge.u), int(edge.v)}) {
+            if (open_degrees[vertex] == 0) {
+                counters.forced_prunes++;
+                return false;
+            }
+            if (open_degrees[vertex] != 1)
+                continue;
+            const Edge<V> & forced = edges[last_edge[vertex]];
+            int other = forced.u == vertex ? forced.v : forced.u;
+            color_t color_vertex = state.colors[vertex];
+            color_t color_other = state.colors[other];
+            if (color_vertex != NO_COLOR and color_vertex == color_other) {
+                counters.forced_prunes++;
+                return false;
+            }
+            if (color_vertex != NO_COLOR and color_other == NO_COLOR) {
+                state.colors[other] = SolutionState<V>::getOppositeColor(color_vertex);
+                counters.forced_moves++;
+            } else if (color_other != NO_COLOR and color_vertex == NO_COLOR) {
+                state.colors[vertex] = SolutionState<V>::getOppositeColor(color_other);
+                counters.forced_moves++;
+            }
+        }
+        return true;
     }
 
-    void findBestStateDFS(SolutionState state) {
+    void findBestStateDFS(SolutionState<V> state) {
+        if (timeIsUp())
+            return;
         // Count recursive calls
-        recursive_calls++;
+        counters.countNode();
+        if (!bound_path.empty() and (counters.nodes & 1023) == 0)
+            syncBoundFile();
         // Check if better solution found
         if (state.isLeaf()) {
+            counters.leaves++;
             if (state.isConnected() and state.isBetterThan(best_state)) {
                 best_state = state;
+                counters.countImprovement(state.cost);
+                if (time_limit > 0)
+                    printImprovement();
                 return;
             } else {
                 return;
@@ -239,40 +1646,64 @@ private:
         // Cut the tree of solutions
         if (noBetterSolutionPossible(state))
             return;
+        OpenDegreesScope open_degrees_scope(open_degrees, edges, state);
+        if (!propagateForcedMoves(state))
+            return;
+        // A searched state with the same colors proves that the subtree cannot beat the best cost
+        uint64_t key = 0;
+        if (transposition_table) {
+            key = transpositionKey(state);
+            if (transposition_table->cutsOff(key, state.used_edges, state.cost, best_state.cost))
+                return;
+        }
+        // Enumerate the completions of the last few uncolored vertices
+        if (leaf_vertices > 0) {
+            int uncolored[V::max_vertices];
+            int k = 0;
+            for (int i = 0; i < state.num_of_vertices; i++)
+                if (state.colors[i] == NO_COLOR)
+                    uncolored[k++] = i;
+            if (k <= leaf_vertices) {
+                findBestStateLeaves(state, uncolored, k);
+                if (transposition_table)
+                    storeTransposition(key, state);
+                return;
+            }
+        }
         // Color the graph to keep bipartity.
         int u = edges[state.edge_index].u;
         int v = edges[state.edge_index].v;
         if ((state.colors[u] == RED and state.colors[v] == RED) or
             (state.colors[u] == BLUE and state.colors[v] == BLUE)){
             {
-                SolutionState opt_skip = state;
+                SolutionState<V> opt_skip = state;
                 opt_skip.skipEdge();
                 findBestStateDFS(opt_skip);
             }
         } else if (state.colors[u] == NO_COLOR and state.colors[v] == NO_COLOR) {
             {
-                SolutionState opt_add_red_blue = state;
+                SolutionState<V> opt_add_red_blue = state;
                 opt_add_red_blue.addEdge();
                 opt_add_red_blue.colors[u] = RED;
                 opt_add_red_blue.colors[v] = BLUE;
                 findBestStateDFS(opt_add_red_blue);
             }
             {
-                SolutionState opt_add_blue_red = state;
+                SolutionState<V> opt_add_blue_red = state;
                 opt_add_blue_red.addEdge();
                 opt_add_blue_red.colors[u] = BLUE;
                 opt_add_blue_red.colors[v] = RED;
                 findBestStateDFS(opt_add_blue_red);
             }
             {
-                SolutionState opt_skip_red_red = state;
+                SolutionState<V> opt_skip_red_red = state;
                 opt_skip_red_red.skipEdge();
                 opt_skip_red_red.colors[u] = RED;
                 opt_skip_red_red.colors[v] = RED;
                 findBestStateDFS(opt_skip_red_red);
             }
             {
-                SolutionState opt_skip_blue_blue = state;
+                SolutionState<V> opt_skip_blue_blue = state;
                 opt_skip_blue_blue.skipEdge();
                 opt_skip_blue_blue.colors[u] = BLUE;
                 opt_skip_blue_blue.colors[v] = BLUE;
@@ -281,13 +1712,13 @@ private:
         } else if ((state.colors[u] == RED and state.colors[v] == NO_COLOR) or
                    (state.colors[u] == BLUE and state.colors[v] == NO_COLOR)) {
             {
-                SolutionState opt_add_opposite = state;
+                SolutionState<V> opt_add_opposite = state;
                 opt_add_opposite.addEdge();
-                opt_add_opposite.colors[v] = SolutionState::getOppositeColor(opt_add_opposite.colors[u]);
+                opt_add_opposite.colors[v] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[u]);
                 findBestStateDFS(opt_add_opposite);
             }
             {
-                SolutionState opt_skip_same = state;
+                SolutionState<V> opt_skip_same = state;
                 opt_skip_same.skipEdge();
                 opt_skip_same.colors[v] = opt_skip_same.colors[u];
                 findBestStateDFS(opt_skip_same);
@@ -295,13 +1726,13 @@ private:
         } else if ((state.colors[u] == NO_COLOR and state.colors[v] == RED) or
                    (state.colors[u] == NO_COLOR and state.colors[v] == BLUE)) {
             {
-                SolutionState opt_add_opposite = state;
+                SolutionState<V> opt_add_opposite = state;
                 opt_add_opposite.addEdge();
-                opt_add_opposite.colors[u] = SolutionState::getOppositeColor(opt_add_opposite.colors[v]);
+                opt_add_opposite.colors[u] = SolutionState<V>::getOppositeColor(opt_add_opposite.colors[v]);
                 findBestStateDFS(opt_add_opposite);
             }
             {
-                SolutionState opt_skip_same = state;
+                SolutionState<V> opt_skip_same = state;
                 opt_skip_same.skipEdge();
                 opt_skip_same.colors[u] = opt_skip_same.colors[v];
                 findBestStateDFS(opt_skip_same);
@@ -309,21 +1740,538 @@ private:
         } else if ((state.colors[u] == RED and state.colors[v] == BLUE) or
                    (state.colors[u] == BLUE and state.colors[v] == RED)) {
             {
-                SolutionState opt_add = state;
+                SolutionState<V> opt_add = state;
                 opt_add.addEdge();
                 findBestStateDFS(opt_add);
             }
         }
+        if (transposition_table and !time_is_up)
+            storeTransposition(key, state);
     };
 
+    // Graphs of up to GRAY_MAX_VERTICES vertices can be enumerated, the auto engine does it up to GRAY_AUTO_VERTICES
+    bool findBestStateGray() {
+        int n = initial_state.num_of_vertices;
+        if (engine != "gray" and (engine != "auto" or n > GRAY_AUTO_VERTICES or transposition_table))
+            return false;
+        if (n < 2 or n > GRAY_MAX_VERTICES or split_bits > 0)
+            return false;
+        auto result = GraySearch<V>(initial_state).searchPrefix(0, 0, best_state.cost);
+        counters += result.counters;
+        if (result.cost <= best_state.cost)
+            return true;
+        best_state = initial_state;
+        best_state.resetSolution();
+        for (int i = 0; i < initial_state.num_of_vertices; i++)
+            best_state.colors[i] = (result.colors >> i) & 1 ? BLUE : RED;
+        setCutOfColoring();
+        return true;
+    }
+
+    // Small graphs go to the search specialized for their vertex count
+    bool findBestStatePacked() {
+        if constexpr (V::max_vertices <= 64) {
+            static constexpr auto packed_searches = makePackedSearchTable<V>(make_integer_sequence<int, PACKED_MAX_VERTICES + 1>());
+            if (initial_state.num_of_vertices <= PACKED_MAX_VERTICES) {
+                packed_searches[initial_state.num_of_vertices](initial_state, best_state, counters);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Upper bound of the cut of the edges from i to the end. Every triangle has an edge that is not cut, so the lightest
+    // edge of every triangle of an edge disjoint packing is left out of the weight of the suffix. The packing is greedy
+    // from the last edge, the packing of a suffix is the one of the shorter suffix and a triangle of its first edge.
+    void initTriangleBounds() {
+        int n = initial_state.num_of_vertices;
+        vector<int> edge_of(size_t(n) * n, -1);
+        for (int i = 0; i < edges_size; i++)
+            edge_of[edges[i].u * n + edges[i].v] = edge_of[edges[i].v * n + edges[i].u] = i;
+        vector<bool> packed(edges_size, false);
+        triangle_bound.assign(edges_size + 1, 0);
+        uint32_t suffix_weight = 0;
+        uint32_t uncut_weight = 0;
+        for (int i = edges_size - 1; i >= 0; i--) {
+            int u = edges[i].u;
+            int v = edges[i].v;
+            suffix_weight += edges[i].weight;
+            int third = -1;
+            uint32_t lightest = 0;
+            for (int w = 0; w < n; w++) {
+                int a = edge_of[u * n + w];
+                int b = edge_of[v * n + w];
+                if (a <= i or b <= i or packed[a] or packed[b])
+                    continue;
+                uint32_t weight = min({uint32_t(edges[i].weight), uint32_t(edges[a].weight), uint32_t(edges[b].weight)});
+                if (weight > lightest) {
+                    lightest = weight;
+                    third = w;
+                }
+            }
+            if (third >= 0) {
+                packed[i] = packed[edge_of[u * n + third]] = packed[edge_of[v * n + third]] = true;
+                uncut_weight += lightest;
+            }
+            triangle_bound[i] = suffix_weight - uncut_weight;
+        }
+    }
+
+    // Best cost an open state can reach by its remaining edges, the pruning bounds of the search are used if they are tighter
+    uint32_t openStateBound(const SolutionState<V> & state) {
+        if (triangle_bound.empty())
+            initTriangleBounds();
+        uint32_t remaining = min(state.sumWeightRemainingEdges(), triangle_bound[state.edge_index]);
+        // The Russian doll bound of a suffix is its maximum cut
+        if (!suffix_bound.empty())
+            remaining = min(remaining, suffix_bound[state.edge_index]);
+        // No connected cut is better than the maximum cut
+        return min(state.cost + remaining, max_cut_bound);
+    }
+
+    void findBestStateFrontier() {
+        if (resume and Checkpoint<V>::load(checkpoint_path, input_name, initial_state, best_state, solution_states_queue)) {
+            cout << "Resumed from " << checkpoint_path << ", open states: " << solution_states_queue.size() << endl;
+        } else {
+            if (resume)
+                cout << "No valid checkpoint for " << input_name << " in " << checkpoint_path << ", starting from scratch." << endl;
+            generateStatesQueue();
+        }
+        units_total = solution_states_queue.size();
+        last_checkpoint_time = chrono::high_resolution_clock::now();
+        size_t i = 0;
+        for (; i < solution_states_queue.size(); i++) {
+            countOpenDegrees(solution_states_queue[i]);
+            findBestStateDFS(solution_states_queue[i]);
+            // A state interrupted by the time limit stays open
+            if (timeIsUp())
+                break;
+            units_done++;
+            if (checkpoint_path.empty())
+                continue;
+            auto now = chrono::high_resolution_clock::now();
+            if (now - last_checkpoint_time >= chrono::seconds(checkpoint_interval)) {
+                vector<SolutionState<V>> frontier(solution_states_queue.begin() + long(i) + 1, solution_states_queue.end());
+                Checkpoint<V>::save(checkpoint_path, input_name, best_state, frontier);
+                last_checkpoint_time = now;
+            }
+        }
+        if (timeIsUp()) {
+            vector<SolutionState<V>> frontier(solution_states_queue.begin() + long(i), solution_states_queue.end());
+            for (auto & state : frontier)
+                open_bound = max(open_bound, openStateBound(state));
+            // Keep the open states, the search can be resumed with more time
+            if (!checkpoint_path.empty())
+                Checkpoint<V>::save(checkpoint_path, input_name, best_state, frontier);
+        } else if (!checkpoint_path.empty()) {
+            // The checkpoint always belongs to the instance in progress
+            fs::remove(checkpoint_path);
+        }
+    }
+
+    void search() {
+        initial_state.edges = this->edges;
+        if (split_bits == 0 and initial_state.isBipartite() and initial_state.isConnected()) {
+            best_state = initial_state;
+            // Every edge is cut, a bipartite block is also bounded by its whole weight
+            setCutOfColoring();
+        } else if ((!max_cut_first or !findBestStateByMaxCut()) and !findBestStateByTreeDecomposition()) {
+            initial_state.resetSolution();
+            if (split_bits > 0)
+                precolorSplitVertices();
+            initLastEdges();
+            if (tt_memory > 0)
+                initTranspositionTable();
+            if (russian_doll)
+                initSuffixBounds();
+            if (checkpoint_path.empty() and time_limit == 0) {
+                // The specialized searches have no transposition table, no enumeration of the leaves and no suffix bounds.
+                // The enumeration of the leaves is faster than the packed search on every input, so the packed search
+                // runs only with --leaf-vertices 0. Like the Gray code engine it is chosen only by the auto engine,
+                // --engine edge keeps the search of findBestStateDFS.
+                bool packed = engine == "auto" and !transposition_table and leaf_vertices == 0 and !russian_doll;
+                if (engine == "vertex")
+                    VertexSearch<V>::run(initial_state, best_state, counters);
+                else if (!findBestStateGray() and (!packed or !findBestStatePacked())) {
+                    countOpenDegrees(initial_state);
+                    findBestStateDFS(initial_state);
+                }
+            } else {
+                findBestStateFrontier();
+            }
+        }
+    }
+
+    // Tarjan's algorithm, the edges of every biconnected block are popped from the edge stack
+    void findBlocks(int v, int parent_edge, const vector<vector<pair<int, int>>> & adjacency, vector<int> & discovery,
+                    vector<int> & low, int & time, vector<int> & edge_stack, vector<vector<int>> & blocks) const {
+        discovery[v] = low[v] = ++time;
+        for (auto [w, e] : adjacency[v]) {
+            if (e == parent_edge)
+                continue;
+            if (discovery[w] == 0) {
+                edge_stack.push_back(e);
+                findBlocks(w, e, adjacency, discovery, low, time, edge_stack, blocks);
+                low[v] = min(low[v], low[w]);
+                if (low[w] >= discovery[v]) {
+                    blocks.emplace_back();
+                    int top;
+                    do {
+                        top = edge_stack.back();
+                        edge_stack.pop_back();
+                        blocks.back().push_back(top);
+                    } while (top != e);
+                }
+            } else if (discovery[w] < discovery[v]) {
+                edge_stack.push_back(e);
+                low[v] = min(low[v], discovery[w]);
+            }
+        }
+    }
+
+    // Searches one block as a separate instance, returns the upper bound of its cost
+    template <typename W>
+    uint32_t solveBlock(const vector<InputEdge> & block_edges, int num_of_vertices, vector<color_t> & block_colors) {
+        auto block = make_unique<ProblemInstance<W>>(input_name, num_of_vertices, block_edges);
+        block->is_block = true;
+        block->start_time = start_time;
+        bool costs_of_graph = search_progress.hideCosts();
+        block->search();
+        search_progress.restore(costs_of_graph);
+        counters += block->counters;
+        block_colors.assign(block->best_state.colors, block->best_state.colors + num_of_vertices);
+        return max(block->best_state.cost, block->open_bound);
+    }
+
+    // The optimum is the sum of the optima of the biconnected blocks, because the coloring of a block can be
+    // flipped to agree with the rest of the graph on its articulation point. Bridges and pendant edges are
+    // blocks of a single edge. Returns false if the graph is a single block.
+    bool findBestStateByBlocks() {
+        int n = initial_state.num_of_vertices;
+        vector<vector<pair<int, int>>> adjacency(n);
+        for (int i = 0; i < edges_size; i++) {
+            adjacency[edges[i].u].emplace_back(edges[i].v, i);
+            adjacency[edges[i].v].emplace_back(edges[i].u, i);
+        }
+        vector<int> discovery(n, 0);
+        vector<int> low(n, 0);
+        vector<int> edge_stack;
+        vector<vector<int>> blocks;
+        int time = 0;
+        if (n > 0)
+            findBlocks(0, -1, adjacency, discovery, low, time, edge_stack, blocks);
+        if (blocks.size() <= 1 or find(discovery.begin(), discovery.end(), 0) != discovery.end())
+            return false;
+        size_t largest_block = 0;
+        for (auto & block : blocks)
+            largest_block = max(largest_block, block.size());
+        cout << "Preprocessing: " << blocks.size() << " biconnected blocks, the largest has " << largest_block << " edges" << endl;
+        // Search every block with its vertices renumbered from 0
+        vector<vector<int>> block_vertices(blocks.size());
+        vector<vector<color_t>> block_colors(blocks.size());
+        vector<int> local(n, -1);
+        uint32_t upper_bound = 0;
+        for (size_t b = 0; b < blocks.size(); b++) {
+            vector<InputEdge> block_edges;
+            for (int e : blocks[b]) {
+                for (int vertex : {int(edges[e].u), int(edges[e].v)}) {
+                    if (local[vertex] < 0) {
+                        local[vertex] = int(block_vertices[b].size());
+                        block_vertices[b].push_back(vertex);
+                    }
+                }
+                block_edges.emplace_back(local[edges[e].u], local[edges[e].v], edges[e].weight);
+            }
+            for (int vertex : block_vertices[b])
+                local[vertex] = -1;
+            int block_size = int(block_vertices[b].size());
+            if (block_size <= Vertices64::max_vertices)
+                upper_bound += solveBlock<Vertices64>(block_edges, block_size, block_colors[b]);
+            else if (block_size <= Vertices150::max_vertices)
+                upper_bound += solveBlock<Vertices150>(block_edges, block_size, block_colors[b]);
+            else
+                upper_bound += solveBlock<Vertices1024>(block_edges, block_size, block_colors[b]);
+        }
+        // Walk the block tree, every next block shares exactly one colored vertex with the blocks before it
+        vector<vector<int>> vertex_blocks(n);
+        for (size_t b = 0; b < blocks.size(); b++)
+            for (int vertex : block_vertices[b])
+                vertex_blocks[vertex].push_back(int(b));
+        initial_state.edges = this->edges;
+        best_state = initial_state;
+        vector<bool> block_done(blocks.size(), false);
+        queue<int> blocks_queue;
+        blocks_queue.push(0);
+        block_done[0] = true;
+        while (!blocks_queue.empty()) {
+            int b = blocks_queue.front();
+            blocks_queue.pop();
+            bool flip = false;
+            for (size_t i = 0; i < block_vertices[b].size(); i++) {
+                // A block cut short by the time limit may have uncolored vertices
+                color_t color = block_colors[b][i] == BLUE ? BLUE : RED;
+                if (best_state.colors[block_vertices[b][i]] != NO_COLOR) {
+                    flip = best_state.colors[block_vertices[b][i]] != color;
+                    break;
+                }
+            }
+            for (size_t i = 0; i < block_vertices[b].size(); i++) {
+                int vertex = block_vertices[b][i];
+                color_t color = block_colors[b][i] == BLUE ? BLUE : RED;
+                best_state.colors[vertex] = flip ? SolutionState<V>::getOppositeColor(color) : color;
+                for (int next_block : vertex_blocks[vertex]) {
+                    if (!block_done[next_block]) {
+                        block_done[next_block] = true;
+                        blocks_queue.push(next_block);
+                    }
+                }
+            }
+        }
+        setCutOfColoring();
+        open_bound = upper_bound;
+        search_progress.improve(best_state.cost);
+        return true;
+    }
+
+    // The maximum cut is searched without the connectivity, which prunes more, and it is checked afterwards. Returns
+    // false if it is not connected, the connected search then stops as soon as it reaches the cost of the cut.
+    bool findBestStateByMaxCut() {
+        if (split_bits > 0)
+            return false;
+        initial_state.resetSolution();
+        SolutionState<V> max_cut = best_state;
+        bool costs_of_graph = search_progress.hideCosts();
+        VertexSearch<V>::run(initial_state, max_cut, counters, false);
+        search_progress.restore(costs_of_graph);
+        // No cut is better than the shared bound, the connected ones neither
+        if (max_cut.cost <= best_state.cost)
+            return true;
+        if (max_cut.isCutConnected()) {
+            best_state = max_cut;
+            search_progress.improve(best_state.cost);
+            if (!is_block)
+                cout << "Max-cut-first: the maximum cut is connected" << endl;
+            return true;
+        }
+        max_cut_bound = max_cut.cost;
+        if (!is_block)
+            cout << "Max-cut-first: the maximum cut = " << max_cut_bound << " is not connected, searching the connected ones" << endl;
+        return false;
+    }
+
+    // Completes best_state from its coloring, the used edges are the edges of the cut
+    void setCutOfColoring() {
+        for (int i = 0; i < edges_size; i++) {
+            if (best_state.colors[edges[i].u] != best_state.colors[edges[i].v]) {
+                best_state.cost += edges[i].weight;
+                best_state.used_edges++;
+            }
+        }
+        best_state.edge_index = edges_size;
+        best_state.sum_cost_all = best_state.edges_total_weight;
+    }
+
+    // The maximum cut of a connected graph is connected and spans all vertices, otherwise flipping the colors of
+    // one of its components would cut more edges. It is solved by eliminating the vertices one by one, the
+    // neighbours of an eliminated vertex form a bag of the tree decomposition. Returns false if the width of the
+    // min-degree elimination order is over max_dp_width or its tables are too big, see DP_SEARCH_MARGIN.
+    bool findBestStateByTreeDecomposition() {
+        if (max_dp_width <= 0 or split_bits > 0 or !initial_state.isConnected())
+            return false;
+        int n = initial_state.num_of_vertices;
+        vector<set<int>> neighbours(n);
+        for (int i = 0; i < edges_size; i++) {
+            neighbours[edges[i].u].insert(edges[i].v);
+            neighbours[edges[i].v].insert(edges[i].u);
+        }
+        vector<int> order;
+        vector<vector<int>> scopes(n);
+        vector<bool> eliminated(n, false);
+        int width = 0;
+        uint64_t cells = 0;
+        uint64_t max_cells = min((uint64_t(DP_MAX_MIB) << 20) / 5, uint64_t(1) << min(max(n - DP_SEARCH_MARGIN, 0), 62));
+        for (int step = 0; step < n; step++) {
+            int v = -1;
+            for (int u = 0; u < n; u++)
+                if (!eliminated[u] and (v < 0 or neighbours[u].size() < neighbours[v].size()))
+                    v = u;
+            width = max(width, int(neighbours[v].size()));
+            if (width > max_dp_width)
+                return false;
+            cells += uint64_t(1) << min(int(neighbours[v].size()), 62);
+            if (cells > max_cells)
+                return false;
+            // The neighbours of v become a clique
+            scopes[v].assign(neighbours[v].begin(), neighbours[v].end());
+            for (int a : scopes[v]) {
+                neighbours[a].erase(v);
+                for (int b : scopes[v])
+                    if (a != b)
+                        neighbours[a].insert(b);
+            }
+            eliminated[v] = true;
+            order.push_back(v);
+        }
+        if (!is_block)
+            cout << "Tree decomposition of width " << width << ", solved by dynamic programming" << endl;
+        // A table of the best cost for every coloring of its scope, bit i is the color of scope[i]
+        struct Factor {
+            vector<int> scope;
+            vector<uint32_t> values;
+        };
+        vector<Factor> factors;
+        vector<vector<int>> factors_of(n);
+        for (int i = 0; i < edges_size; i++) {
+            factors.push_back({{edges[i].u, edges[i].v}, {0, edges[i].weight, edges[i].weight, 0}});
+            factors_of[edges[i].u].push_back(i);
+            factors_of[edges[i].v].push_back(i);
+        }
+        vector<bool> consumed(factors.size(), false);
+        // Color of the eliminated vertex for every coloring of its scope
+        vector<vector<uint8_t>> choices(n);
+        for (int v : order) {
+            const vector<int> & scope = scopes[v];
+            int k = int(scope.size());
+            vector<int> bucket;
+            for (int f : factors_of[v]) {
+                if (!consumed[f]) {
+                    consumed[f] = true;
+                    bucket.push_back(f);
+                }
+            }
+            // Bit of every variable of the bucket in the coloring of scope + v, v is bit k
+            vector<vector<int>> bits(bucket.size());
+            for (size_t f = 0; f < bucket.size(); f++)
+                for (int vertex : factors[bucket[f]].scope)
+                    bits[f].push_back(vertex == v ? k : int(find(scope.begin(), scope.end(), vertex) - scope.begin()));
+            Factor result{scope, vector<uint32_t>(size_t(1) << k)};
+            choices[v].assign(size_t(1) << k, 0);
+            for (uint32_t coloring = 0; coloring < (1u << k); coloring++) {
+                uint32_t best[2] = {0, 0};
+                for (uint32_t color = 0; color < 2; color++) {
+                    uint32_t full_coloring = coloring | color << k;
+                    for (size_t f = 0; f < bucket.size(); f++) {
+                        uint32_t index = 0;
+                        for (size_t j = 0; j < bits[f].size(); j++)
+                            index |= ((full_coloring >> bits[f][j]) & 1) << j;
+                        best[color] += factors[bucket[f]].values[index];
+                    }
+                }
+                result.values[coloring] = max(best[0], best[1]);
+                choices[v][coloring] = best[1] > best[0];
+            }
+            for (int f : bucket)
+                vector<uint32_t>().swap(factors[f].values);
+            for (int vertex : scope)
+                factors_of[vertex].push_back(int(factors.size()));
+            factors.push_back(move(result));
+            consumed.push_back(false);
+        }
+        // The scope of every vertex is eliminated after it, so it is colored first
+        initial_state.resetSolution();
+        best_state = initial_state;
+        for (auto it = order.rbegin(); it != order.rend(); it++) {
+            uint32_t coloring = 0;
+            for (size_t j = 0; j < scopes[*it].size(); j++)
+                coloring |= uint32_t(best_state.colors[scopes[*it][j]] == BLUE) << j;
+            best_state.colors[*it] = choices[*it][coloring] ? BLUE : RED;
+        }
+        setCutOfColoring();
+        return true;
+    }
+
+    void printImprovement() {
+        // The cost of a block is not the cost of the instance
+        if (is_block)
+            return;
+        auto now = chrono::high_resolution_clock::now();
+        cout << "Improved: " << best_state.cost << " after " << prettyPrintElapsedTime(start_time, now) << " colors: ";
+        for (int i = 0; i < best_state.num_of_vertices; i++)
+            cout << (best_state.colors[i] == RED ? 'R' : 'B');
+        cout << endl;
+    }
+
+    // The highest degree vertex is red, the colorings with it blue are the same cuts. The colors of the next
+    // split_bits vertices are the bits of split_job.
+    void precolorSplitVertices() {
+        int n = initial_state.num_of_vertices;
+        vector<int> degree(n, 0);
+        for (int i = 0; i < edges_size; i++) {
+            degree[edges[i].u]++;
+            degree[edges[i].v]++;
+        }
+        vector<int> vertices(n);
+        iota(vertices.begin(), vertices.end(), 0);
+        stable_sort(vertices.begin(), vertices.end(), [&](int a, int b) { return degree[a] > degree[b]; });
+        initial_state.colors[vertices[0]] = RED;
+        for (int i = 0; i < split_bits and i + 1 < n; i++)
+            initial_state.colors[vertices[i + 1]] = (split_job >> i) & 1 ? BLUE : RED;
+        cout << "Split job " << split_job << " of " << (1 << split_bits) << ", precolored " << min(split_bits + 1, n) << " vertices" << endl;
+    }
+
+    static uint32_t readBoundFile() {
+        uint32_t bound = 0;
+        ifstream bound_file(bound_path);
+        bound_file >> bound;
+        return bound;
+    }
+
+    // Replaces the bound file if the best cost is better. The lock keeps two jobs from replacing a better cost by
+    // a worse one, the rename keeps the readers from reading it half written.
+    void updateBoundFile() const {
+        int lock = open((bound_path + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+        if (lock >= 0)
+            flock(lock, LOCK_EX);
+        if (best_state.cost > readBoundFile()) {
+            string temporary_path = bound_path + "." + to_string(getpid());
+            {
+                ofstream bound_file(temporary_path);
+                bound_file << best_state.cost << endl;
+            }
+            fs::rename(temporary_path, bound_path);
+        }
+        if (lock >= 0)
+            close(lock);
+    }
+
+    // The split jobs that run at the same time exchange their best costs while they search. A job publishes its own
+    // solution and prunes by the best cost of the others, the coloring of that cost is printed by its job.
+    void syncBoundFile() {
+        auto now = chrono::high_resolution_clock::now();
+        if (now < next_bound_sync)
+            return;
+        next_bound_sync = now + chrono::seconds(BOUND_SYNC_SECONDS);
+        // Below the shared bound the cost is the one read from the file, not a solution of this job
+        if (best_state.cost >= shared_bound)
+            updateBoundFile();
+        uint32_t bound = readBoundFile();
+        if (bound > shared_bound) {
+            shared_bound = bound;
+            if (best_state.cost < bound - 1) {
+                best_state.cost = bound - 1;
+                search_progress.improve(best_state.cost);
+            }
+        }
+    }
+
     void printResult() {
         auto end_time = chrono::high_resolution_clock::now();
         cout << "============================================" << endl;
         cout << "Result of: " << this->input_name << endl;
         cout << "--------------------------------------------" << endl;
-        vector<uint8_t> reds;
-        vector<uint8_t> blues;
-        for (uint8_t i = 0; i < this->best_state.num_of_vertices; i++)
+        if (!bound_path.empty() and best_state.cost < shared_bound) {
+            cout << "No solution as good as the shared bound = " << shared_bound << endl;
+            cout << "--------------------------------------------" << endl;
+            cout << "Recursive calls: " << formatWithCommas(counters.nodes) << endl;
+            if (print_stats)
+                counters.printJson(chrono::duration<double>(end_time - start_time).count(), 1);
+            cout << "Took: " << prettyPrintElapsedTime(start_time, end_time) << endl;
+            cout << "============================================" << endl;
+            return;
+        }
+        vector<int> reds;
+        vector<int> blues;
+        for (int i = 0; i < this->best_state.num_of_vertices; i++)
             if (this->best_state.colors[i] == RED)
                 reds.push_back(i);
             else
@@ -341,7 +2289,7 @@ private:
         }
         cout << "}" << endl;
         cout << "--------------------------------------------" << endl;
-        vector<Edge> used_edges;
+        vector<Edge<V>> used_edges;
         for (int i = 0; i < edges_size; i++)
             if (best_state.colors[edges[i].u] != best_state.colors[edges[i].v])
                 used_edges.push_back(edges[i]);
@@ -354,42 +2302,132 @@ private:
         cout << "--------------------------------------------" << endl;
         cout << "Weights sum = " << best_state.cost << endl;
         cout << "--------------------------------------------" << endl;
-        cout << "Recursive calls: " << formatWithCommas(recursive_calls) << endl;
+        if (time_is_up) {
+            uint32_t upper_bound = max(best_state.cost, open_bound);
+            cout << "Time limit reached, upper bound = " << upper_bound << ", gap = " << upper_bound - best_state.cost << endl;
+            cout << "--------------------------------------------" << endl;
+        }
+        cout << "Recursive calls: " << formatWithCommas(counters.nodes) << endl;
+        if (print_stats)
+            counters.printJson(chrono::duration<double>(end_time - start_time).count(), 1);
+        if (transposition_table) {
+            uint64_t probes = transposition_table->getProbes();
+            uint64_t hits = transposition_table->getHits();
+            cout << "Transposition table: " << formatWithCommas(probes) << " probes, " << formatWithCommas(hits) << " hits ("
+                 << fixed << setprecision(1) << (probes > 0 ? 100.0 * double(hits) / double(probes) : 0.0) << " %)" << endl;
+            cout.unsetf(ios::floatfield);
+        }
         cout << "Took: " << prettyPrintElapsedTime(start_time, end_time) << endl;
         cout << "============================================" << endl;
+        printRecord(end_time);
+    }
+
+    void printRecord(time_point end_time) const {
+        if (output_format == "text")
+            return;
+        ResultRecord record;
+        record.backend = "sequential";
+        record.input = input_name;
+        record.vertices = best_state.num_of_vertices;
+        record.edges = edges_size;
+        record.cost = best_state.cost;
+        for (int i = 0; i < best_state.num_of_vertices; i++)
+            (best_state.colors[i] == RED ? record.red : record.blue).push_back(i);
+        record.elapsed_us = chrono::duration_cast<chrono::microseconds>(end_time - start_time).count();
+        record.nodes = counters.nodes;
+        record.threads = 1;
+        record.ranks = 1;
+        record.print(record_output);
     }
 public:
-    ProblemInstance(string input_name, int num_of_vertices, vector<Edge> edges) {
-        for (edges_size = 0; edges_size < min(sizeof(this->edges), edges.size()); edges_size++) {
-            this->edges[edges_size] = edges[edges_size];
+    ProblemInstance(string input_name, int num_of_vertices, const vector<InputEdge> & edges) {
+        // Inputs are dispatched by their size, so all the edges fit
+        for (edges_size = 0; size_t(edges_size) < min<size_t>(V::max_edges, edges.size()); edges_size++) {
+            this->edges[edges_size] = Edge<V>(edges[edges_size].u, edges[edges_size].v, edges[edges_size].weight);
             this->initial_state.edges_total_weight += edges[edges_size].weight;
         }
-        sort(this->edges, this->edges + edges_size, greater<>());
+        // Binary inputs are sorted already
+        if (!is_sorted(this->edges, this->edges + edges_size, greater<>()))
+            sort(this->edges, this->edges + edges_size, greater<>());
         initial_state.num_of_vertices = num_of_vertices;
         initial_state.edges_size = edges_size;
         best_state = this->initial_state;
 
         this->input_name = std::move(input_name);
-        recursive_calls = 0;
     }
 
-    string getInputName() {
+    string getInputName() override {
         return input_name;
     }
 
-    uint32_t getBestStateCost() const {
+    uint32_t getBestStateCost() const override {
         return best_state.cost;
     }
 
-    void findMaxConnectedBipartiteSubgraph() {
-        start_time = chrono::high_resolution_clock::now();
+    int getNumOfVertices() const override {
+        return initial_state.num_of_vertices;
+    }
+
+    vector<InputEdge> getEdges() const override {
+        vector<InputEdge> input_edges;
+        for (int i = 0; i < edges_size; i++)
+            input_edges.emplace_back(edges[i].u, edges[i].v, edges[i].weight);
+        return input_edges;
+    }
+
+    bool acceptBatchColoring(const vector<color_t> & colors, time_point batch_start_time) override {
         initial_state.edges = this->edges;
-        if (initial_state.isBipartite() and initial_state.isConnected()) {
+        initial_state.resetSolution();
+        best_state = initial_state;
+        for (int i = 0; i < initial_state.num_of_vertices; i++)
+            best_state.colors[i] = colors[i];
+        if (!best_state.isCutConnected()) {
             best_state = initial_state;
-        } else {
-            initial_state.resetSolution();
-            findBestStateDFS(initial_state);
+            return false;
         }
+        setCutOfColoring();
+        start_time = batch_start_time;
+        printResult();
+        return true;
+    }
+
+    // Called by the progress reporter while the search runs
+    ProgressSample progressSample() const {
+        ProgressSample sample;
+        sample.nodes = search_progress.nodes.load(memory_order_relaxed);
+        sample.best_cost = search_progress.best_cost.load(memory_order_relaxed);
+        sample.units_done = units_done.load(memory_order_relaxed);
+        sample.units_total = units_total.load(memory_order_relaxed);
+        return sample;
+    }
+
+    void findMaxConnectedBipartiteSubgraph() override {
+        start_time = chrono::high_resolution_clock::now();
+        deadline = start_time + chrono::seconds(time_limit);
+        time_is_up = false;
+        if (estimate_probes > 0) {
+            printEstimate();
+            return;
+        }
+        // Reports until the result is printed
+        unique_ptr<ProgressReporter> progress_reporter;
+        search_progress.reset();
+        if (progress_interval > 0)
+            progress_reporter = make_unique<ProgressReporter>(input_name, [this] { return progressSample(); });
+        // Solutions as good as the bound are still searched for, the job that found it may have stopped early
+        if (!bound_path.empty()) {
+            shared_bound = readBoundFile();
+            best_state.cost = shared_bound > 0 ? shared_bound - 1 : 0;
+            search_progress.improve(best_state.cost);
+            next_bound_sync = chrono::high_resolution_clock::now() + chrono::seconds(BOUND_SYNC_SECONDS);
+        }
+        // A checkpoint holds the states of one search and a split job searches a part of the colorings,
+        // so both search the whole graph
+        if (!preprocess or !checkpoint_path.empty() or split_bits > 0 or !findBestStateByBlocks())
+            search();
+        if (!bound_path.empty() and best_state.cost >= shared_bound)
+            updateBoundFile();
+        progress_reporter.reset();
         printResult();
     }
 };
@@ -403,42 +2441,164 @@ public:
         cout << "   -h, --help                  Výpíše tuto zprávu." << endl;
         cout << "   --file <filepath>...        Spustí program pro soubory." << endl;
         cout << "   --folder <folderpath>...    Spustí program pro složky." << endl;
+        cout << "   --checkpoint <file>         Průběžně ukládá stav prohledávání do souboru." << endl;
+        cout << "   --checkpoint-interval <s>   Interval ukládání v sekundách. Defaultní hodnota je 60." << endl;
+        cout << "   --resume <file>             Pokračuje ve výpočtu uloženém v souboru a dále do něj ukládá." << endl;
+        cout << "   --time-limit <s>            Časový limit v sekundách. Vypisuje každé zlepšení a skončí s nejlepším řešením." << endl;
+        cout << "   --dp-width <k>              Největší šířka stromového rozkladu řešená dynamickým programováním. Defaultní hodnota je 22, 0 vypne." << endl;
+        cout << "                               Rozklad s tabulkami přes 2^(n - 4) buněk nebo 1 GiB se nepoužije, graf se prohledá." << endl;
+        cout << "   --tt-memory <MiB>           Velikost transpoziční tabulky prohledaných podstromů. Vypíše úspěšnost. Defaultně vypnuto." << endl;
+        cout << "   --engine <auto|edge|vertex|gray>  Větvení po hranách, po vrcholech se ziskem obarvení, nebo výčet všech obarvení v Grayově kódu" << endl;
+        cout << "                               (do 32 vrcholů). Auto vyčísluje grafy do 20 vrcholů. S --checkpoint a --time-limit vždy po hranách." << endl;
+        cout << "   --max-cut-first             Nejdříve najde maximální řez bez podmínky souvislosti, souvislé řezy hledá jen pokud není souvislý." << endl;
+        cout << "   --leaf-vertices <k>         Prohledávání po hranách vyčíslí všechna dobarvení posledních k vrcholů. Defaultní hodnota je 10, 0 vypne." << endl;
+        cout << "                               Grafy do 32 vrcholů pak s --engine auto prohledá specializované prohledávání s obarvením v jednom slově." << endl;
+        cout << "   --batch                     Řeší grafy do 20 vrcholů po 16 najednou vektorovými instrukcemi. Vypíše počet grafů za sekundu." << endl;
+        cout << "   --russian-doll              Před prohledáváním spočítá maximální řezy všech sufixů hran a použije je jako odhad zbytku." << endl;
+        cout << "   --no-preprocess             Vypne rozklad grafu na 2-souvislé komponenty před prohledáváním." << endl;
+        cout << "   --estimate <probes>         Jen odhadne počet uzlů a dobu prohledávání po hranách náhodnými sondami (Knuthova metoda)." << endl;
+        cout << "   --progress <s>              Každých s sekund vypíše na chybový výstup uzly za sekundu, nejlepší cenu, podíl hotových" << endl;
+        cout << "                               stavů fronty a odhad zbývajícího času. Defaultně vypnuto." << endl;
+        cout << "   --progress-file <file>      Poslední zprávu o průběhu zapisuje do souboru místo chybového výstupu." << endl;
+        cout << "   --stats                     Vypíše počítadla prohledávání (uzly, listy, ořezání, zlepšení, úlohy) jako JSON." << endl;
+        cout << "   --output <json|csv>         Vypíše výsledek každého vstupu jako záznam na standardní výstup, text jde na chybový výstup." << endl;
+        cout << "   --split <k> --job <i>       Prohledá jen i-tou z 2^k částí obarvení vrcholů s nejvyšším stupněm." << endl;
+        cout << "   --bound-file <file>         Sdílená nejlepší cena mezi úlohami rozděleného výpočtu. Prohledávání po hranách ji každou sekundu" << endl;
+        cout << "                               přečte a zapíše svou, ostatní prohledávání ji čtou jen na začátku." << endl;
         cout << "Parametry jsou vyhodnocvány v pořadí." << endl;
         cout << "Jorge Zuňiga 2023" << endl;
     }
 
-    static vector<ProblemInstance> readFromFile(const string & input_file_path) {
-        vector<ProblemInstance> inputs;
-        cout << "Loaded file " << input_file_path << endl;
-        if (!fs::exists(fs::path(input_file_path))) {
-            cout << "File \"" << input_file_path << "\' does not exist." << endl;
-            return inputs;
+    // Reads the next integer, skips anything before it
+    static int scanInt(const char * & it, const char * end) {
+        while (it != end and (*it < '0' or *it > '9') and *it != '-')
+            it++;
+        bool negative = it != end and *it == '-';
+        if (negative)
+            it++;
+        int value = 0;
+        while (it != end and '0' <= *it and *it <= '9')
+            value = value * 10 + (*it++ - '0');
+        return negative ? -value : value;
+    }
+
+    // Skips the next number without converting it
+    static void skipInt(const char * & it, const char * end) {
+        while (it != end and *it <= ' ')
+            it++;
+        while (it != end and *it > ' ')
+            it++;
+    }
+
+    // Binary instance, the edges are already filtered and sorted, see converter/converter.cpp
+    static bool parseBinary(const char * it, const char * end, int & num_of_vertices, vector<InputEdge> & edges) {
+        // Vertices are stored as bytes, so binary instances always fit in Vertices150
+        using BinaryEdge = Edge<Vertices150>;
+        static_assert(sizeof(BinaryEdge) == 3, "Edges are stored as three bytes");
+        // The edge count is little endian whatever the host is
+        uint8_t n = uint8_t(it[4]);
+        uint16_t edges_size = uint16_t(uint8_t(it[5]) | uint8_t(it[6]) << 8);
+        const BinaryEdge * edges_begin = reinterpret_cast<const BinaryEdge *>(it + BINARY_HEADER_SIZE);
+        if (n > Vertices150::max_vertices or edges_size > Vertices150::max_edges or end - it < BINARY_HEADER_SIZE + edges_size * long(sizeof(BinaryEdge)))
+            return false;
+        num_of_vertices = n;
+        edges.reserve(edges_size);
+        for (const BinaryEdge * edge = edges_begin; edge != edges_begin + edges_size; edge++) {
+            // A malformed file would index past the vertices
+            if (edge->u >= n or edge->v >= n or edge->u == edge->v or edge->weight < MIN_WEIGHT or edge->weight > MAX_WEIGHT)
+                return false;
+            edges.emplace_back(edge->u, edge->v, edge->weight);
         }
-        ifstream input_file(input_file_path);
-        if (!input_file.is_open()) {
-            cout << "Error opening " << input_file_path << endl;
-            return inputs;
+        return true;
+    }
+
+    // The file is mapped into memory, only the upper triangle of the matrix is converted
+    static bool parseFile(const string & input_file_path, int & num_of_vertices, vector<InputEdge> & edges) {
+        int fd = open(input_file_path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) < 0 or file_stat.st_size == 0) {
+            close(fd);
+            return false;
         }
-        int num_of_vertices = 0;
-        vector<Edge> edges;
-        input_file >> num_of_vertices;
-        for (int row = 0; row < num_of_vertices; row ++) {
-            for (int column = 0; column < num_of_vertices; column++) {
-                int weight;
-                input_file >> weight;
-                if (column > row and MIN_WEIGHT <= weight and weight <= MAX_WEIGHT) {
-                    Edge edge(row, column, weight);
-                    edges.push_back(edge);
+        size_t size = file_stat.st_size;
+        void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        const char * it = static_cast<const char *>(data);
+        const char * end = it + size;
+        bool parsed = true;
+        if (size >= BINARY_HEADER_SIZE and memcmp(it, BINARY_MAGIC, 4) == 0) {
+            parsed = parseBinary(it, end, num_of_vertices, edges);
+        } else {
+            num_of_vertices = scanInt(it, end);
+            // Too large inputs are reported by the caller
+            if (num_of_vertices > Vertices1024::max_vertices)
+                num_of_vertices = -num_of_vertices;
+            edges.reserve(max(num_of_vertices, 0) * max(num_of_vertices - 1, 0) / 2);
+            for (int row = 0; row < num_of_vertices; row++) {
+                for (int column = 0; column <= row; column++)
+                    skipInt(it, end);
+                for (int column = row + 1; column < num_of_vertices; column++) {
+                    int weight = scanInt(it, end);
+                    if (MIN_WEIGHT <= weight and weight <= MAX_WEIGHT)
+                        edges.emplace_back(row, column, weight);
                 }
             }
         }
-        input_file.close();
-        inputs.emplace_back(input_file_path, num_of_vertices, edges);
+        munmap(data, size);
+        return parsed;
+    }
+
+    // Every input is solved with the smallest vertex count class it fits in
+    static unique_ptr<Instance> makeInstance(const string & input_file_path, int num_of_vertices, const vector<InputEdge> & edges) {
+        if (num_of_vertices <= Vertices64::max_vertices)
+            return make_unique<ProblemInstance<Vertices64>>(input_file_path, num_of_vertices, edges);
+        if (num_of_vertices <= Vertices150::max_vertices)
+            return make_unique<ProblemInstance<Vertices150>>(input_file_path, num_of_vertices, edges);
+        return make_unique<ProblemInstance<Vertices1024>>(input_file_path, num_of_vertices, edges);
+    }
+
+    static vector<unique_ptr<Instance>> readFromFiles(const vector<string> & input_file_paths) {
+        vector<int> nums_of_vertices(input_file_paths.size(), 0);
+        vector<vector<InputEdge>> edges(input_file_paths.size());
+        vector<char> parsed(input_file_paths.size(), false);
+        // Files are taken from a shared counter, the results keep the input order
+        atomic<size_t> next_file{0};
+        auto parseFiles = [&]() {
+            for (size_t i = next_file++; i < input_file_paths.size(); i = next_file++)
+                parsed[i] = parseFile(input_file_paths[i], nums_of_vertices[i], edges[i]);
+        };
+        size_t num_of_threads = min<size_t>(max(1u, thread::hardware_concurrency()), input_file_paths.size());
+        vector<thread> threads;
+        for (size_t i = 1; i < num_of_threads; i++)
+            threads.emplace_back(parseFiles);
+        parseFiles();
+        for (auto & t : threads)
+            t.join();
+        vector<unique_ptr<Instance>> inputs;
+        for (size_t i = 0; i < input_file_paths.size(); i++) {
+            cout << "Loaded file " << input_file_paths[i] << endl;
+            if (!fs::exists(fs::path(input_file_paths[i])))
+                cout << "File \"" << input_file_paths[i] << "\' does not exist." << endl;
+            else if (!parsed[i])
+                cout << "Error opening " << input_file_paths[i] << endl;
+            else if (nums_of_vertices[i] < 0)
+                cout << "Too many vertices in " << input_file_paths[i] << ", at most " << Vertices1024::max_vertices << " are supported." << endl;
+            else
+                inputs.push_back(makeInstance(input_file_paths[i], nums_of_vertices[i], edges[i]));
+        }
         return inputs;
     }
 
-    static vector<ProblemInstance> readFromFolder(const string & input_folder_path) {
-        vector<ProblemInstance> inputs;
+    static vector<unique_ptr<Instance>> readFromFile(const string & input_file_path) {
+        return readFromFiles({input_file_path});
+    }
+
+    static vector<unique_ptr<Instance>> readFromFolder(const string & input_folder_path) {
+        vector<unique_ptr<Instance>> inputs;
         cout << "Loaded folder " << input_folder_path << endl;
         if ( ! fs::is_directory(fs::path(input_folder_path))) {
             cout << "Folder \"" << input_folder_path << "\" does not exist" << endl;
@@ -449,15 +2609,11 @@ public:
             paths_to_files.push_back(entry.path());
         }
         sort(paths_to_files.begin(), paths_to_files.end());
-        for (const auto & file_path : paths_to_files) {
-            vector<ProblemInstance> input = readFromFile(file_path);
-            inputs.insert(inputs.end(), input.begin(), input.end());
-        }
-        return inputs;
+        return readFromFiles(paths_to_files);
     }
 
-    static vector<ProblemInstance> readInput(int argc, char* argv[]) {
-        vector<ProblemInstance> inputs;
+    static vector<unique_ptr<Instance>> readInput(int argc, char* argv[]) {
+        vector<unique_ptr<Instance>> inputs;
         vector<string> args(argv + 1, argv+argc);
         // Find flags -h, --help, --file <filepath>..., --folder <folderpath>...
         bool help_arg_found_short = find(args.begin(), args.end(), "-h") != args.end();
@@ -472,21 +2628,132 @@ public:
             InputHandler::printHelp();
             return inputs;
         }
+        // If --output json|csv is found, print a record per instance and move the text to the standard error
+        auto output_arg_it = find(args.begin(), args.end(), "--output");
+        if (output_arg_it != args.end() and next(output_arg_it) != args.end()) {
+            output_format = *next(output_arg_it);
+            if (output_format == "json" or output_format == "csv") {
+                cout.rdbuf(cerr.rdbuf());
+            } else {
+                cout << "Unknown output format " << output_format << endl;
+                output_format = "text";
+            }
+        }
+        // If --checkpoint <file> or --resume <file> is found, checkpoint the search into the file
+        auto checkpoint_arg_it = find(args.begin(), args.end(), "--checkpoint");
+        if (checkpoint_arg_it != args.end() and next(checkpoint_arg_it) != args.end())
+            checkpoint_path = *next(checkpoint_arg_it);
+        auto resume_arg_it = find(args.begin(), args.end(), "--resume");
+        if (resume_arg_it != args.end() and next(resume_arg_it) != args.end()) {
+            checkpoint_path = *next(resume_arg_it);
+            resume = true;
+        }
+        auto checkpoint_interval_arg_it = find(args.begin(), args.end(), "--checkpoint-interval");
+        if (checkpoint_interval_arg_it != args.end() and next(checkpoint_interval_arg_it) != args.end()) {
+            istringstream iss(*next(checkpoint_interval_arg_it));
+            iss >> checkpoint_interval;
+        }
+        // If --time-limit <s> is found, stop at the deadline with the best solution found so far
+        auto time_limit_arg_it = find(args.begin(), args.end(), "--time-limit");
+        if (time_limit_arg_it != args.end() and next(time_limit_arg_it) != args.end()) {
+            istringstream iss(*next(time_limit_arg_it));
+            iss >> time_limit;
+        }
+        // If --dp-width <k> is found, solve the graphs with tree decompositions up to width k by dynamic programming
+        auto dp_width_arg_it = find(args.begin(), args.end(), "--dp-width");
+        if (dp_width_arg_it != args.end() and next(dp_width_arg_it) != args.end()) {
+            istringstream iss(*next(dp_width_arg_it));
+            iss >> max_dp_width;
+        }
+        // If --tt-memory <MiB> is found, memoize the searched subtrees in a transposition table of that size
+        auto tt_memory_arg_it = find(args.begin(), args.end(), "--tt-memory");
+        if (tt_memory_arg_it != args.end() and next(tt_memory_arg_it) != args.end()) {
+            istringstream iss(*next(tt_memory_arg_it));
+            iss >> tt_memory;
+        }
+        // If --engine <auto|edge|vertex|gray> is found, branch on the edges or on the vertices or enumerate
+        auto engine_arg_it = find(args.begin(), args.end(), "--engine");
+        if (engine_arg_it != args.end() and next(engine_arg_it) != args.end()) {
+            engine = *next(engine_arg_it);
+            if (engine != "auto" and engine != "edge" and engine != "vertex" and engine != "gray") {
+                cout << "Unknown engine " << engine << endl;
+                engine = "auto";
+            }
+        }
+        // If --max-cut-first is found, search the maximum cut and check its connectivity afterwards
+        if (find(args.begin(), args.end(), "--max-cut-first") != args.end())
+            max_cut_first = true;
+        // If --leaf-vertices <k> is found, enumerate the completions of the last k uncolored vertices, 0 = off
+        auto leaf_vertices_arg_it = find(args.begin(), args.end(), "--leaf-vertices");
+        if (leaf_vertices_arg_it != args.end() and next(leaf_vertices_arg_it) != args.end()) {
+            istringstream iss(*next(leaf_vertices_arg_it));
+            iss >> leaf_vertices;
+            leaf_vertices = clamp(leaf_vertices, 0, LEAF_MAX_VERTICES);
+        }
+        // If --batch is found, solve the small instances together
+        if (find(args.begin(), args.end(), "--batch") != args.end())
+            batch = true;
+        // If --estimate <probes> is found, only estimate the size of the search by random probes
+        auto estimate_arg_it = find(args.begin(), args.end(), "--estimate");
+        if (estimate_arg_it != args.end() and next(estimate_arg_it) != args.end()) {
+            istringstream iss(*next(estimate_arg_it));
+            iss >> estimate_probes;
+        }
+        // If --russian-doll is found, bound the remaining edges by the maximum cuts of the edge suffixes
+        if (find(args.begin(), args.end(), "--russian-doll") != args.end())
+            russian_doll = true;
+        // If --no-preprocess is found, search the whole graph without splitting it into blocks
+        if (find(args.begin(), args.end(), "--no-preprocess") != args.end())
+            preprocess = false;
+        // If --progress <s> is found, report the progress of the search every s seconds
+        auto progress_arg_it = find(args.begin(), args.end(), "--progress");
+        if (progress_arg_it != args.end() and next(progress_arg_it) != args.end()) {
+            istringstream iss(*next(progress_arg_it));
+            iss >> progress_interval;
+        }
+        // If --progress-file <file> is found, keep the last progress report in the file instead of the standard error
+        auto progress_file_arg_it = find(args.begin(), args.end(), "--progress-file");
+        if (progress_file_arg_it != args.end() and next(progress_file_arg_it) != args.end())
+            progress_path = *next(progress_file_arg_it);
+        // If --stats is found, print the search counters of every instance as JSON
+        if (find(args.begin(), args.end(), "--stats") != args.end())
+            print_stats = true;
+        // If --split <k> --job <i> is found, search only the i-th of the 2^k precolorings
+        auto split_arg_it = find(args.begin(), args.end(), "--split");
+        if (split_arg_it != args.end() and next(split_arg_it) != args.end()) {
+            istringstream iss(*next(split_arg_it));
+            iss >> split_bits;
+        }
+        auto job_arg_it = find(args.begin(), args.end(), "--job");
+        if (job_arg_it != args.end() and next(job_arg_it) != args.end()) {
+            istringstream iss(*next(job_arg_it));
+            iss >> split_job;
+        }
+        if (split_bits < 0 or split_bits > 30 or split_job < 0 or split_job >= (1 << split_bits)) {
+            cout << "Wrong split job " << split_job << " of 2^" << split_bits << endl;
+            return inputs;
+        }
+        // If --bound-file <file> is found, share the best cost with the other jobs through the file
+        auto bound_file_arg_it = find(args.begin(), args.end(), "--bound-file");
+        if (bound_file_arg_it != args.end() and next(bound_file_arg_it) != args.end())
+            bound_path = *next(bound_file_arg_it);
         // If --file <filepath>... is present, extract from files
         if (file_arg_found) {
             auto input_files_it = next(file_arg_it);
-            while (input_files_it != args.end() and *input_files_it != "--folder") {
-                vector<ProblemInstance> file_input = InputHandler::readFromFile(*input_files_it);
-                inputs.insert(inputs.end(), file_input.begin(), file_input.end());
+            vector<string> input_file_paths;
+            while (input_files_it != args.end() and !input_files_it->empty() and input_files_it->front() != '-') {
+                input_file_paths.push_back(*input_files_it);
                 input_files_it = next(input_files_it);
             }
+            vector<unique_ptr<Instance>> file_inputs = InputHandler::readFromFiles(input_file_paths);
+            inputs.insert(inputs.end(), make_move_iterator(file_inputs.begin()), make_move_iterator(file_inputs.end()));
         }
         // If --folder <folderpath>... is present, extract from folders
         if (folder_arg_found) {
             auto input_folders_it = next(folder_arg_it);
-            while (input_folders_it != args.end() and *input_folders_it != "--file") {
-                vector<ProblemInstance> folder_inputs = InputHandler::readFromFolder(*input_folders_it);
-                inputs.insert(inputs.end(), folder_inputs.begin(), folder_inputs.end());
+            while (input_folders_it != args.end() and !input_folders_it->empty() and input_folders_it->front() != '-') {
+                vector<unique_ptr<Instance>> folder_inputs = InputHandler::readFromFolder(*input_folders_it);
+                inputs.insert(inputs.end(), make_move_iterator(folder_inputs.begin()), make_move_iterator(folder_inputs.end()));
                 input_folders_it = next(input_folders_it);
             }
         }
@@ -494,22 +2761,118 @@ public:
     }
 };
 
+// Maximum cuts of BATCH_LANES graphs of n vertices at once. The weights are transposed, the weight of the edge (v, w)
+// in lane l is weights[(v * n + w) * BATCH_LANES + l], missing edges and padding vertices have zero weight. All lanes
+// walk the same colorings in Gray code order, so the sign of every edge is the same in all of them and the costs are
+// updated by vector adds. The clones are picked by the CPU at load time.
+__attribute__((target_clones("avx512f", "avx2", "default")))
+void batchMaxCut(int n, const int32_t * weights, int32_t * best_costs, uint32_t * best_colors) {
+    int32_t costs[BATCH_LANES] = {0};
+    for (int lane = 0; lane < BATCH_LANES; lane++) {
+        best_costs[lane] = 0;
+        best_colors[lane] = 0;
+    }
+    uint32_t colors = 0;
+    // The last vertex stays red, swapping the colors gives the same cut
+    for (uint64_t i = 1; i < uint64_t(1) << (n - 1); i++) {
+        int v = __builtin_ctzll(i);
+        uint32_t color_v = (colors >> v) & 1;
+        const int32_t * row = weights + size_t(v) * n * BATCH_LANES;
+        for (int w = 0; w < n; w++) {
+            int32_t sign = ((colors >> w) & 1) == color_v ? 1 : -1;
+            for (int lane = 0; lane < BATCH_LANES; lane++)
+                costs[lane] += sign * row[w * BATCH_LANES + lane];
+        }
+        colors ^= 1u << v;
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            bool better = costs[lane] > best_costs[lane];
+            best_costs[lane] = better ? costs[lane] : best_costs[lane];
+            best_colors[lane] = better ? colors : best_colors[lane];
+        }
+    }
+}
+
+// Solves the instances of up to BATCH_MAX_VERTICES vertices in batches, the instances of a batch are padded to the
+// largest one by isolated vertices. The maximum cut of a connected graph is connected, an instance whose cut is not is
+// left to the search. Returns which instances were solved.
+vector<char> solveInBatches(const vector<unique_ptr<Instance>> & inputs) {
+    vector<char> solved(inputs.size(), false);
+    if (!checkpoint_path.empty() or time_limit > 0 or split_bits > 0 or !bound_path.empty())
+        return solved;
+    vector<size_t> small;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        int n = inputs[i]->getNumOfVertices();
+        if (2 <= n and n <= BATCH_MAX_VERTICES)
+            small.push_back(i);
+    }
+    // Instances of the same size share a batch, so there is little padding
+    stable_sort(small.begin(), small.end(), [&inputs](size_t a, size_t b) {
+        return inputs[a]->getNumOfVertices() < inputs[b]->getNumOfVertices();
+    });
+    auto start_time = chrono::high_resolution_clock::now();
+    size_t graphs = 0;
+    for (size_t first = 0; first < small.size(); first += BATCH_LANES) {
+        size_t lanes = min<size_t>(BATCH_LANES, small.size() - first);
+        int n = inputs[small[first + lanes - 1]]->getNumOfVertices();
+        vector<int32_t> weights(size_t(n) * n * BATCH_LANES, 0);
+        for (size_t lane = 0; lane < lanes; lane++) {
+            for (auto & edge : inputs[small[first + lane]]->getEdges()) {
+                weights[(size_t(edge.u) * n + edge.v) * BATCH_LANES + lane] = edge.weight;
+                weights[(size_t(edge.v) * n + edge.u) * BATCH_LANES + lane] = edge.weight;
+            }
+        }
+        int32_t best_costs[BATCH_LANES];
+        uint32_t best_colors[BATCH_LANES];
+        auto batch_start_time = chrono::high_resolution_clock::now();
+        batchMaxCut(n, weights.data(), best_costs, best_colors);
+        for (size_t lane = 0; lane < lanes; lane++) {
+            size_t i = small[first + lane];
+            vector<color_t> colors(inputs[i]->getNumOfVertices());
+            for (size_t v = 0; v < colors.size(); v++)
+                colors[v] = (best_colors[lane] >> v) & 1 ? BLUE : RED;
+            solved[i] = inputs[i]->acceptBatchColoring(colors, batch_start_time);
+            graphs += solved[i];
+        }
+    }
+    auto end_time = chrono::high_resolution_clock::now();
+    if (graphs > 0) {
+        double seconds = chrono::duration<double>(end_time - start_time).count();
+        cout << "============================================" << endl;
+        cout << "Batch: " << graphs << " graphs in " << prettyPrintElapsedTime(start_time, end_time) << ", "
+             << fixed << setprecision(0) << (seconds > 0 ? double(graphs) / seconds : 0.0) << " graphs/s" << endl;
+        cout.unsetf(ios::floatfield);
+    }
+    return solved;
+}
+
+// The microbenchmarks include this file and have their own main
+#ifndef SEQUENTIAL_NO_MAIN
 int main(int argc, char* argv[]) {
     // Read input
-    vector<ProblemInstance> inputs = InputHandler::readInput(argc, argv);
+    auto start_time_load = chrono::high_resolution_clock::now();
+    vector<unique_ptr<Instance>> inputs = InputHandler::readInput(argc, argv);
+    auto end_time_load = chrono::high_resolution_clock::now();
     // Measure time
     auto start_time_total = chrono::high_resolution_clock::now();
-    // Find solutions
-    for (auto & problem_instance : inputs)
-        problem_instance.findMaxConnectedBipartiteSubgraph();
+    // Find solutions, the small ones in batches first
+    vector<char> solved = batch ? solveInBatches(inputs) : vector<char>(inputs.size(), false);
+    for (size_t i = 0; i < inputs.size(); i++)
+        if (!solved[i])
+            inputs[i]->findMaxConnectedBipartiteSubgraph();
     // End of time measure
     auto end_time_total = chrono::high_resolution_clock::now();
-    // Print total time if more than one result
-    if (inputs.size() > 1) {
+    // Print load time, total time if more than one result
+    if (!inputs.empty()) {
         cout << "============================================" << endl;
-        cout << "Total time: " << prettyPrintElapsedTime(start_time_total, end_time_total) << endl;
+        cout << "Load time: " << prettyPrintElapsedTime(start_time_load, end_time_load) << endl;
+        if (inputs.size() > 1)
+            cout << "Total time: " << prettyPrintElapsedTime(start_time_total, end_time_total) << endl;
         cout << "============================================" << endl;
     }
+    // A split job searches a part of the colorings only, its merged result is checked by the reducer, an estimate
+    // has no result
+    if (split_bits > 0 or estimate_probes > 0)
+        return 0;
     // Assert
     unordered_map<string, uint32_t> results = {
         // Easy
@@ -548,14 +2911,16 @@ int main(int argc, char* argv[]) {
         {"graf_30_25.txt", 21336}
     };
     // Print if wrong result
-    for (auto problem_instance : inputs) {
-        string name = fs::path(problem_instance.getInputName()).filename();
+    for (auto & problem_instance : inputs) {
+        // Binary inputs share the name of the text input
+        string name = fs::path(problem_instance->getInputName()).stem().string() + ".txt";
         if (results.count(name) > 0) {
             uint32_t expected = results[name];
-            uint32_t got = problem_instance.getBestStateCost();
+            uint32_t got = problem_instance->getBestStateCost();
             if (got != expected)
-                cout << problem_instance.getInputName() << " expected: " << expected << " got: " << got << endl;
+                cout << problem_instance->getInputName() << " expected: " << expected << " got: " << got << endl;
         }
     }
     return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Merges the outputs of the jobs of a split run (sequential --split <k> --job <i>).
+# Prints the best result of every input and checks that all 2^k jobs have finished.
+# Usage: ./reduce_split.sh <number of jobs> <job output>...
+
+if [ $# -lt 2 ]
+then
+  echo "Usage: $0 <number of jobs> <job output>..."
+  exit 1
+fi
+JOBS=$1
+shift
+
+awk -v jobs="${JOBS}" '
+/^Result of: / { input = substr($0, 12); block = ""; in_block = 1 }
+in_block { block = block $0 "\n" }
+/^Weights sum = / { cost = $4 + 0 }
+/^No solution as good as the shared bound/ { cost = -1 }
+/^Took: / && in_block {
+  finished[input]++
+  if (!(input in best) || cost > best[input]) {
+    best[input] = cost
+    best_block[input] = block
+  }
+  in_block = 0
+  cost = -1
+}
+END {
+  status = 0
+  for (input in best) {
+    print "============================================"
+    printf "%s", best_block[input]
+    if (finished[input] != jobs) {
+      print "Finished jobs: " finished[input] " of " jobs
+      status = 1
+    }
+  }
+  print "============================================"
+  exit status
+}
+' "$@"
@@ -0,0 +1,36 @@
+#!/bin/sh
+
+#  ===========================================================================
+# |                                                                           |
+# |             COMMAND FILE FOR SUBMITTING SGE JOBS                          |
+# |                                                                           |
+# |                                                                           |
+# | SGE keyword statements begin with #$                                      |
+# |                                                                           |
+# | Comments begin with #                                                     |
+# | Any line whose first non-blank character is a pound sign (#)              |
+# | and is not a SGE keyword statement is regarded as a comment.              |
+#  ===========================================================================
+
+# Request Bourne shell as shell for job
+#$ -S /bin/sh
+
+# Execute the job from the current working directory.
+#$ -cwd
+
+# Defines  or  redefines  the  path used for the standard error stream of the job.
+#$ -e .
+
+# The path used for the standard output stream of the job.
+#$ -o .
+
+# Do not change.
+#$ -pe ompi 1
+
+# Array of 16 tasks, task i searches the colorings of the split job i - 1.
+# Merge the outputs with: ../reduce_split.sh 16 array_job_seq_split_24_23.sh.o*
+# Running tasks exchange their best cost through the bound file every second
+# (edge search only, the other engines read it just once at the start).
+#$ -t 1-16
+
+./sequential.exe --split 4 --job $((SGE_TASK_ID - 1)) --bound-file bound_24_23.txt --file ../inputs/24_23